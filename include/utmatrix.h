@@ -10,64 +10,245 @@
 
 #include <iostream>
 #include <exception>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <cmath>
+#include "utmatrix_index.h"
+#include "utmatrix_alloc.h"
+#include "utmatrix_mmap.h"
+#include "utmatrix_binary.h"
+#include "utmatrix_text.h"
+#include "utmatrix_expr.h"
+#include "utmatrix_simd.h"
+#include "utmatrix_view.h"
+#include "utmatrix_threads.h"
+#include "utmatrix_stream.h"
 
 using namespace std;
 
-const int MAX_VECTOR_SIZE = 100000000;
-const int MAX_MATRIX_SIZE = 10000;
+// Проверка индексов в operator[] у TVector, TMatrixRow и TMatrix.
+// Интерфейс лабораторной требует исключения при неверном индексе, поэтому
+// проверка включена по умолчанию; сборка с UTMATRIX_CHECK_BOUNDS=0
+// оставляет в operator[] только адресную арифметику. Методы UncheckedAt
+// не проверяют индекс никогда.
+#ifndef UTMATRIX_CHECK_BOUNDS
+#define UTMATRIX_CHECK_BOUNDS 1
+#endif
+const bool CHECK_BOUNDS = UTMATRIX_CHECK_BOUNDS != 0;
+
+// Число элементов, которые TVector хранит внутри объекта, без обращения к
+// куче (0 - всегда в куче). Действует для тривиальных типов элементов и
+// распределителя по умолчанию: вектор с явно заданным распределителем
+// всегда получает память от него
+#ifndef UTMATRIX_VECTOR_INLINE_SIZE
+#define UTMATRIX_VECTOR_INLINE_SIZE 4
+#endif
+const TIndex VECTOR_INLINE_SIZE = UTMATRIX_VECTOR_INLINE_SIZE;
+const int TRMM_BLOCK_SIZE = 64;      // сторона блока при умножении матриц
+const int TRMM_SIMPLE_THRESHOLD = 64; // порядок, до которого умножение идет без блоков
+const int TRSM_BLOCK_SIZE = 64;      // число строк в блоке при решении с многими правыми частями
+
+// Начальное значение элементов новой матрицы
+enum TMatrixInit
+{
+  INIT_UNINITIALIZED, // без инициализации (для классов - конструктор по умолчанию)
+  INIT_ZERO           // ValType(); для арифметических типов - обнуленная calloc память
+};
+
+// Число матриц, разделяющих буфер в режиме копирования при записи.
+// Unshareable ставится, когда владелец выдал изменяемую строку, ссылку или
+// представление: такой буфер принадлежит одной матрице, и его копии сразу
+// получают свой буфер
+struct TSharedCount
+{
+  std::atomic<int> Count;
+  bool Unshareable;
+  TSharedCount() : Count(1), Unshareable(false) {}
+};
+
+template <class ValType, class AllocType = TAlignedAllocator<ValType> >
+class TMatrix;
 
-// Шаблон вектора
+// Копирование count элементов в несовпадающий буфер: для тривиально
+// копируемых типов - одним memcpy, для остальных - присваиванием
 template <class ValType>
-class TVector
+void CopyElements(ValType *pDst, const ValType *pSrc, TIndex count)
+{
+	if constexpr (std::is_trivially_copyable<ValType>::value)
+	{
+		if (count > 0)
+		{
+			std::memcpy(pDst, pSrc, count * sizeof(ValType));
+		}
+	}
+	else
+	{
+		std::copy(pSrc, pSrc + count, pDst);
+	}
+} /*-------------------------------------------------------------------------*/
+
+// Буфер для Capacity элементов внутри объекта вектора
+template <class ValType, TIndex Capacity, bool = (Capacity > 0)>
+struct TInlineBuffer
+{
+  ValType Elements[Capacity];
+  ValType* Data() { return Elements; }
+  const ValType* Data() const { return Elements; }
+};
+
+template <class ValType, TIndex Capacity>
+struct TInlineBuffer<ValType, Capacity, false>
+{
+  ValType* Data() { return nullptr; }
+  const ValType* Data() const { return nullptr; }
+};
+
+// Число элементов, которые TVector хранит внутри объекта: только для
+// тривиальных типов и стандартного распределителя
+template <class ValType, class AllocType>
+struct TVectorInlineCapacity : std::integral_constant<TIndex, std::is_trivial<ValType>::value &&
+  std::is_same<AllocType, std::allocator<ValType> >::value ? VECTOR_INLINE_SIZE : 0> {};
+
+// Шаблон вектора; AllocType - распределитель памяти (utmatrix_alloc.h).
+// Короткие векторы (до VECTOR_INLINE_SIZE элементов) хранятся внутри
+// объекта, поэтому перемещение и обмен такого вектора копируют элементы:
+// data(), итераторы и ссылки на элементы после них недействительны (у
+// длинных векторов они переходят к вектору, получившему буфер).
+// Встроенный буфер - базовый класс, и пустой буфер не увеличивает объект
+template <class ValType, class AllocType = std::allocator<ValType> >
+class TVector : public TVectorExpr<TVector<ValType, AllocType> >,
+  private TInlineBuffer<ValType, TVectorInlineCapacity<ValType, AllocType>::value>
 {
 protected:
-  ValType *pVector;
-  int Size;       // размер вектора
-  int StartIndex; // индекс первого элемента вектора
+  static const TIndex INLINE_CAPACITY = TVectorInlineCapacity<ValType, AllocType>::value;
+  typedef TInlineBuffer<ValType, INLINE_CAPACITY> TInline;
+
+  ValType *pVector;  // элементы: InlineData() или память распределителя
+  TIndex Size;       // размер вектора
+  TIndex StartIndex; // индекс первого элемента вектора
+  AllocType Alloc;
+
+  ValType* InlineData() { return TInline::Data(); }
+  const ValType* InlineData() const { return TInline::Data(); }
+  ValType* AllocateBuffer(TIndex n) // буфер для n элементов
+  {
+	  return n <= INLINE_CAPACITY ? InlineData() : AllocateElements(Alloc, n, false);
+  }
+  void FreeBuffer(ValType *p, TIndex n)
+  {
+	  if (p != InlineData())
+		  FreeElements(Alloc, p, n);
+  }
+  bool IsInline() const { return INLINE_CAPACITY > 0 && pVector == InlineData(); }
+  void Steal(TVector &v) noexcept; // забрать элементы v; у вектора нет буфера
+
+  // вычисление выражения в буфер; простые выражения сводятся к
+  // векторизованным ядрам (utmatrix_simd.h)
+  template <class ExprType>
+  void Evaluate(const ExprType &e);
+  void Evaluate(const TVectorBinary<TVector, TVector, TAddOp> &e);
+  void Evaluate(const TVectorBinary<TVector, TVector, TSubOp> &e);
+  void Evaluate(const TVectorScalar<TVector, TAddOp> &e);
+  void Evaluate(const TVectorScalar<TVector, TSubOp> &e);
+  void Evaluate(const TVectorScalar<TVector, TMulOp> &e);
 public:
-  TVector(int s = 10, int si = 0);
+  typedef ValType ValueType;
+  typedef ValType value_type;               // совместимость с STL:
+  typedef ValType* iterator;                // элементы лежат подряд, итераторы -
+  typedef const ValType* const_iterator;    // указатели на хранимые элементы; у
+                                            // векторов до VECTOR_INLINE_SIZE
+                                            // элементов их делают недействительными
+                                            // перемещение и swap, как и data()
+
+  TVector(TIndex s = 10, TIndex si = 0, const AllocType &alloc = AllocType());
   TVector(const TVector &v);                // конструктор копирования
+  TVector(TVector &&v) noexcept;            // конструктор перемещения
+  template <class ExprType>
+  TVector(const TVectorExpr<ExprType> &e, const AllocType &alloc = AllocType()); // вычисление выражения
   ~TVector();
-  int GetSize() const { return Size; } // размер вектора
-  int GetStartIndex() const { return StartIndex; } // индекс первого элемента
-  ValType& operator[](int pos);             // доступ
-  const ValType& operator[](int pos) const;
+  const AllocType& GetAllocator() const { return Alloc; }
+  TIndex GetSize() const { return Size; } // размер вектора
+  TIndex GetStartIndex() const { return StartIndex; } // индекс первого элемента
+  ValType& operator[](TIndex pos);          // доступ
+  const ValType& operator[](TIndex pos) const;
+  ValType& UncheckedAt(TIndex pos) { return pVector[pos - StartIndex]; } // доступ без проверки
+  const ValType& UncheckedAt(TIndex pos) const { return pVector[pos - StartIndex]; }
+  ValType* data() { return pVector; }       // хранимые элементы [begin(), end())
+  const ValType* data() const { return pVector; }
+  iterator begin() { return pVector; }
+  iterator end() { return pVector + Size; }
+  const_iterator begin() const { return pVector; }
+  const_iterator end() const { return pVector + Size; }
   bool operator==(const TVector &v) const;  // сравнение
   bool operator!=(const TVector &v) const;  // сравнение
   TVector& operator=(const TVector &v);     // присваивание
+  TVector& operator=(TVector &&v) noexcept; // перемещающее присваивание
+  template <class ExprType>
+  TVector& operator=(const TVectorExpr<ExprType> &e); // присваивание выражения
+  void swap(TVector &v) noexcept;           // обмен содержимым
+  friend void swap(TVector &v1, TVector &v2) noexcept { v1.swap(v2); }
+
+  // двоичный формат (utmatrix_binary.h); потоки открываются в режиме binary
+  void SaveBinary(std::ostream &out) const;
+  static TVector LoadBinary(std::istream &in, const AllocType &alloc = AllocType());
+  // текст в формате operator<< через to_chars / from_chars (utmatrix_text.h)
+  void WriteText(std::ostream &out) const;
+  void ReadText(std::istream &in);
+
+  const ValType& Eval(TIndex k) const { return pVector[k]; } // элемент для выражений
 
-  // скалярные операции
-  TVector  operator+(const ValType &val) const;   // прибавить скаляр
-  TVector  operator-(const ValType &val) const;   // вычесть скаляр
-  TVector  operator*(const ValType &val) const;   // умножить на скаляр
+  // операции на месте, без выделения памяти
+  TVector& operator+=(const ValType &val);        // прибавить скаляр
+  TVector& operator-=(const ValType &val);        // вычесть скаляр
+  TVector& operator*=(const ValType &val);        // умножить на скаляр
+  TVector& operator/=(const ValType &val);        // разделить на скаляр
+  template <class ExprType>
+  TVector& operator+=(const TVectorExpr<ExprType> &e); // прибавить вектор
+  template <class ExprType>
+  TVector& operator-=(const TVectorExpr<ExprType> &e); // вычесть вектор
+  TVector& operator+=(const TVector &v);
+  TVector& operator-=(const TVector &v);
+  TVector& Axpy(const ValType &alpha, const TVector &x); // this += alpha * x
 
-  // векторные операции
-  TVector  operator+(const TVector &v) const;     // сложение
-  TVector  operator-(const TVector &v) const;     // вычитание
-  ValType  operator*(const TVector &v) const;     // скалярное произведение
+  // Операции над постоянными векторами строят выражения (utmatrix_expr.h);
+  // для временного операнда результат сразу вычисляется в его буфере
+  TVector  operator+(const ValType &val) &&;      // прибавить скаляр
+  TVector  operator-(const ValType &val) &&;      // вычесть скаляр
+  TVector  operator*(const ValType &val) &&;      // умножить на скаляр
+  TVector  operator+(const TVector &v) &&;        // сложение
+  TVector  operator-(const TVector &v) &&;        // вычитание
 
   // ввод-вывод
   friend istream& operator>>(istream &in, TVector &v)
   {
-	  for (int i = 0; i < v.Size; i++)
+	  for (TIndex i = 0; i < v.Size; i++)
 		  in >> v.pVector[i];
 	  return in;
   }
   friend ostream& operator<<(ostream &out, const TVector &v)
   {
-	  for (int i = 0; i < v.GetStartIndex(); ++i)
+	  for (TIndex i = 0; i < v.GetStartIndex(); ++i)
 	  {
 		  out << '\t';
 	  }
-	  for (int i = 0; i < v.Size; i++)
+	  for (TIndex i = 0; i < v.Size; i++)
 		  out << v.pVector[i] << '\t';
 	  return out;
   }
 };
 
-template <class ValType>
-TVector<ValType>::TVector(int s, int si)
-	: Size(s), StartIndex(si)
+template <class ValType, class AllocType>
+TVector<ValType, AllocType>::TVector(TIndex s, TIndex si, const AllocType &alloc)
+	: Size(s), StartIndex(si), Alloc(alloc)
 {
 	if (Size <= 0 || Size > MAX_VECTOR_SIZE)
 	{
@@ -77,51 +258,135 @@ TVector<ValType>::TVector(int s, int si)
 	{
 		throw std::runtime_error("Invalid start index");
 	}
-	pVector = new ValType[Size];
+	pVector = AllocateBuffer(Size);
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> //конструктор копирования
-TVector<ValType>::TVector(const TVector<ValType> &v)
-	: Size(v.Size), StartIndex(v.StartIndex)
+template <class ValType, class AllocType> //конструктор копирования
+TVector<ValType, AllocType>::TVector(const TVector<ValType, AllocType> &v)
+	: Size(v.Size), StartIndex(v.StartIndex),
+	  Alloc(std::allocator_traits<AllocType>::select_on_container_copy_construction(v.Alloc))
 {
-	pVector = new ValType[Size];
-	for (int i = 0; i < Size; ++i)
+	pVector = AllocateBuffer(Size);
+	try
+	{
+		CopyElements(pVector, v.pVector, Size);
+	}
+	catch (...)
 	{
-		pVector[i] = v.pVector[i];
+		FreeBuffer(pVector, Size);
+		throw;
 	}
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType>
-TVector<ValType>::~TVector()
+template <class ValType, class AllocType> //конструктор перемещения
+TVector<ValType, AllocType>::TVector(TVector<ValType, AllocType> &&v) noexcept
+	: Alloc(v.Alloc)
 {
-	delete[] pVector;
+	Steal(v);
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // доступ
-ValType& TVector<ValType>::operator[](int pos)
+template <class ValType, class AllocType> // забрать элементы: буфер распределителя - по указателю, свой - копией
+void TVector<ValType, AllocType>::Steal(TVector<ValType, AllocType> &v) noexcept
+{
+	if (v.IsInline())
+	{
+		pVector = InlineData();
+		CopyElements(pVector, v.pVector, v.Size);
+	}
+	else
+	{
+		pVector = v.pVector;
+	}
+	Size = v.Size;
+	StartIndex = v.StartIndex;
+	v.pVector = nullptr;
+	v.Size = 0;
+	v.StartIndex = 0;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+TVector<ValType, AllocType>::~TVector()
+{
+	FreeBuffer(pVector, Size);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // запись в двоичном формате
+void TVector<ValType, AllocType>::SaveBinary(std::ostream &out) const
+{
+	WriteBinary(out, MakeBinaryHeader(LAYOUT_VECTOR, Size, StartIndex, pVector, Size), pVector);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // чтение из двоичного формата
+TVector<ValType, AllocType> TVector<ValType, AllocType>::LoadBinary(std::istream &in, const AllocType &alloc)
+{
+	const TBinaryHeader h = ReadBinaryHeader(in);
+	CheckBinaryHeader<ValType>(h, LAYOUT_VECTOR);
+	if (h.Size <= 0 || h.Size > MAX_VECTOR_SIZE || h.StartIndex < 0 || h.StartIndex > (int64_t)(PTRDIFF_MAX - MAX_VECTOR_SIZE) ||
+		h.DataSize != (uint64_t)h.Size * sizeof(ValType))
+	{
+		throw std::runtime_error("Can't load vector with invalid size");
+	}
+	TVector v((TIndex)h.Size, (TIndex)h.StartIndex, alloc);
+	ReadBinaryData(in, h, v.pVector);
+	return v;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вывод текста
+void TVector<ValType, AllocType>::WriteText(std::ostream &out) const
+{
+	TTextWriter writer(out);
+	for (TIndex i = 0; i < StartIndex; ++i)
+	{
+		writer.Put('\t');
+	}
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		writer.Write(pVector[i]);
+		writer.Put('\t');
+	}
+	writer.Flush();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // ввод текста
+void TVector<ValType, AllocType>::ReadText(std::istream &in)
+{
+	TTextReader reader(in);
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		reader.Read(pVector[i]);
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // доступ
+ValType& TVector<ValType, AllocType>::operator[](TIndex pos)
 {
 	pos -= StartIndex;
-	if (pos < 0 || pos >= Size)
+	if (CHECK_BOUNDS && (pos < 0 || pos >= Size))
 	{
 		throw std::runtime_error("Invalid index in operator[]");
 	}
 	return pVector[pos];
 } /*-------------------------------------------------------------------------*/
 
-template<class ValType>
-const ValType & TVector<ValType>::operator[](int pos) const
+template <class ValType, class AllocType> // доступ
+const ValType& TVector<ValType, AllocType>::operator[](TIndex pos) const
 {
-	return const_cast<const ValType&>(const_cast<TVector<ValType>&>(*this)[pos]);
-}
+	pos -= StartIndex;
+	if (CHECK_BOUNDS && (pos < 0 || pos >= Size))
+	{
+		throw std::runtime_error("Invalid index in operator[]");
+	}
+	return pVector[pos];
+} /*-------------------------------------------------------------------------*/
 
-template <class ValType> // сравнение
-bool TVector<ValType>::operator==(const TVector &v) const
+template <class ValType, class AllocType> // сравнение
+bool TVector<ValType, AllocType>::operator==(const TVector &v) const
 {
 	if (Size != v.Size || StartIndex != v.StartIndex)
 	{
 		return false;
 	}
-	for (int i = 0; i < Size; ++i)
+	for (TIndex i = 0; i < Size; ++i)
 	{
 		if (pVector[i] != v.pVector[i])
 		{
@@ -131,250 +396,1571 @@ bool TVector<ValType>::operator==(const TVector &v) const
 	return true;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // сравнение
-bool TVector<ValType>::operator!=(const TVector &v) const
+template <class ValType, class AllocType> // сравнение
+bool TVector<ValType, AllocType>::operator!=(const TVector &v) const
 {
 	return !(*this == v);
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // присваивание
-TVector<ValType>& TVector<ValType>::operator=(const TVector &v)
+template <class ValType, class AllocType> // присваивание
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator=(const TVector &v)
 {
 	if (this != &v)
 	{
 		if (Size != v.Size)
 		{
+			// при равных размерах буфер используется повторно;
+			// распределитель у вектора остается свой
+			ValType *p = AllocateBuffer(v.Size);
+			FreeBuffer(pVector, Size);
+			pVector = p;
 			Size = v.Size;
-			delete[] pVector;
-			pVector = new ValType[Size];
-		}
-		for (int i = 0; i < Size; ++i)
-		{
-			pVector[i] = v.pVector[i];
 		}
+		CopyElements(pVector, v.pVector, Size);
 		StartIndex = v.StartIndex;
 	}
 	return *this;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // прибавить скаляр
-TVector<ValType> TVector<ValType>::operator+(const ValType &val) const
+template <class ValType, class AllocType> // вычисление выражения
+template <class ExprType>
+TVector<ValType, AllocType>::TVector(const TVectorExpr<ExprType> &e, const AllocType &alloc)
+	: Size(e.Self().GetSize()), StartIndex(e.Self().GetStartIndex()), Alloc(alloc)
 {
-	TVector<ValType> aResult = *this;
-	for (int i = 0; i < GetSize(); ++i)
+	pVector = AllocateBuffer(Size);
+	try
 	{
-		aResult.pVector[i] += val;
+		Evaluate(e.Self());
+	}
+	catch (...)
+	{
+		FreeBuffer(pVector, Size);
+		throw;
 	}
-	return aResult;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // вычесть скаляр
-TVector<ValType> TVector<ValType>::operator-(const ValType &val) const
+template <class ValType, class AllocType> // присваивание выражения
+template <class ExprType>
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator=(const TVectorExpr<ExprType> &e)
 {
-	TVector<ValType> aResult = *this;
-	for (int i = 0; i < GetSize(); ++i)
+	const ExprType &expr = e.Self();
+	if (Size != expr.GetSize())
 	{
-		aResult.pVector[i] -= val;
+		// вектор другого размера не может быть операндом выражения
+		ValType *p = AllocateBuffer(expr.GetSize());
+		FreeBuffer(pVector, Size);
+		pVector = p;
+		Size = expr.GetSize();
 	}
-	return aResult;
+	StartIndex = expr.GetStartIndex();
+	Evaluate(expr);
+	return *this;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // умножить на скаляр
-TVector<ValType> TVector<ValType>::operator*(const ValType &val) const
+template <class ValType, class AllocType> // вычисление выражения в буфер
+template <class ExprType>
+void TVector<ValType, AllocType>::Evaluate(const ExprType &e)
 {
-	TVector<ValType> aResult = *this;
-	for (int i = 0; i < GetSize(); ++i)
+	for (TIndex k = 0; k < Size; ++k)
 	{
-		aResult.pVector[i] *= val;
+		pVector[k] = e.Eval(k);
 	}
-	return aResult;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // сложение
-TVector<ValType> TVector<ValType>::operator+(const TVector<ValType> &v) const
+template <class ValType, class AllocType>
+void TVector<ValType, AllocType>::Evaluate(const TVectorBinary<TVector, TVector, TAddOp> &e)
+{
+	VecAdd(pVector, e.GetLeft().pVector, e.GetRight().pVector, Size);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+void TVector<ValType, AllocType>::Evaluate(const TVectorBinary<TVector, TVector, TSubOp> &e)
+{
+	VecSub(pVector, e.GetLeft().pVector, e.GetRight().pVector, Size);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+void TVector<ValType, AllocType>::Evaluate(const TVectorScalar<TVector, TAddOp> &e)
+{
+	VecAddScalar(pVector, e.GetExpr().pVector, e.GetValue(), Size);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+void TVector<ValType, AllocType>::Evaluate(const TVectorScalar<TVector, TSubOp> &e)
+{
+	VecSubScalar(pVector, e.GetExpr().pVector, e.GetValue(), Size);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+void TVector<ValType, AllocType>::Evaluate(const TVectorScalar<TVector, TMulOp> &e)
+{
+	VecMulScalar(pVector, e.GetExpr().pVector, e.GetValue(), Size);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // перемещающее присваивание
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator=(TVector<ValType, AllocType> &&v) noexcept
+{
+	TVector<ValType, AllocType> aTemp(std::move(v));
+	swap(aTemp);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // обмен содержимым
+void TVector<ValType, AllocType>::swap(TVector<ValType, AllocType> &v) noexcept
+{
+	if (IsInline() || v.IsInline())
+	{
+		TVector aTemp(std::move(v));
+		v.Alloc = Alloc;
+		v.Steal(*this);
+		Alloc = aTemp.Alloc;
+		Steal(aTemp);
+		return;
+	}
+	std::swap(pVector, v.pVector);
+	std::swap(Size, v.Size);
+	std::swap(StartIndex, v.StartIndex);
+	std::swap(Alloc, v.Alloc);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // прибавить скаляр
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator+=(const ValType &val)
+{
+	VecAddScalar(pVector, pVector, val, Size);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычесть скаляр
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator-=(const ValType &val)
+{
+	VecSubScalar(pVector, pVector, val, Size);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // умножить на скаляр
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator*=(const ValType &val)
+{
+	VecMulScalar(pVector, pVector, val, Size);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // разделить на скаляр
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator/=(const ValType &val)
+{
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		pVector[i] /= val;
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // прибавить вектор
+template <class ExprType>
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator+=(const TVectorExpr<ExprType> &e)
 {
-	if (GetSize() != v.GetSize())
+	const ExprType &expr = e.Self();
+	if (Size != expr.GetSize())
 	{
 		throw std::runtime_error("Can't add vector with different size");
 	}
-	TVector<ValType> aResult = *this;
-	for (int i = 0; i < GetSize(); ++i)
+	for (TIndex k = 0; k < Size; ++k)
 	{
-		aResult.pVector[i] += v[i];
+		pVector[k] += expr.Eval(k);
 	}
-	return aResult;
+	return *this;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // вычитание
-TVector<ValType> TVector<ValType>::operator-(const TVector<ValType> &v) const
+template <class ValType, class AllocType> // вычесть вектор
+template <class ExprType>
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator-=(const TVectorExpr<ExprType> &e)
 {
-	if (GetSize() != v.GetSize())
+	const ExprType &expr = e.Self();
+	if (Size != expr.GetSize())
 	{
 		throw std::runtime_error("Can't substract vector with different size");
 	}
-	TVector<ValType> aResult = *this;
-	for (int i = 0; i < GetSize(); ++i)
+	for (TIndex k = 0; k < Size; ++k)
 	{
-		aResult.pVector[i] -= v[i];
+		pVector[k] -= expr.Eval(k);
 	}
-	return aResult;
+	return *this;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // скалярное произведение
-ValType TVector<ValType>::operator*(const TVector<ValType> &v) const
+template <class ValType, class AllocType> // прибавить вектор
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator+=(const TVector<ValType, AllocType> &v)
 {
-	if (GetSize() != v.GetSize())
+	if (Size != v.Size)
 	{
-		throw std::runtime_error("Can't find dot product for vector with different size");
+		throw std::runtime_error("Can't add vector with different size");
 	}
-	ValType aResult = 0;
-	for (int i = 0; i < GetSize(); ++i)
+	VecAdd(pVector, pVector, v.pVector, Size);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычесть вектор
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::operator-=(const TVector<ValType, AllocType> &v)
+{
+	if (Size != v.Size)
 	{
-		aResult += pVector[i] * v.pVector[i];
+		throw std::runtime_error("Can't substract vector with different size");
 	}
-	return aResult;
+	VecSub(pVector, pVector, v.pVector, Size);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // y += alpha * x
+TVector<ValType, AllocType>& TVector<ValType, AllocType>::Axpy(const ValType &alpha, const TVector<ValType, AllocType> &x)
+{
+	if (Size != x.Size)
+	{
+		throw std::runtime_error("Can't add vector with different size");
+	}
+	VecAxpy(pVector, alpha, x.pVector, Size);
+	return *this;
 } /*-------------------------------------------------------------------------*/
 
+template <class ValType, class AllocType> // прибавить скаляр
+TVector<ValType, AllocType> TVector<ValType, AllocType>::operator+(const ValType &val) &&
+{
+	return std::move(*this += val);
+} /*-------------------------------------------------------------------------*/
 
-// Верхнетреугольная матрица
+template <class ValType, class AllocType> // вычесть скаляр
+TVector<ValType, AllocType> TVector<ValType, AllocType>::operator-(const ValType &val) &&
+{
+	return std::move(*this -= val);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // умножить на скаляр
+TVector<ValType, AllocType> TVector<ValType, AllocType>::operator*(const ValType &val) &&
+{
+	return std::move(*this *= val);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // сложение
+TVector<ValType, AllocType> TVector<ValType, AllocType>::operator+(const TVector<ValType, AllocType> &v) &&
+{
+	return std::move(*this += v);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычитание
+TVector<ValType, AllocType> TVector<ValType, AllocType>::operator-(const TVector<ValType, AllocType> &v) &&
+{
+	return std::move(*this -= v);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // скалярное произведение
+ValType operator*(const TVector<ValType, AllocType> &v1, const TVector<ValType, AllocType> &v2)
+{
+	if (v1.GetSize() != v2.GetSize())
+	{
+		throw std::runtime_error("Can't find dot product for vector with different size");
+	}
+	return VecDot(v1.data(), v2.data(), v1.GetSize());
+} /*-------------------------------------------------------------------------*/
+
+
+// Строка верхнетреугольной матрицы - представление участка общего буфера
+// матрицы; индексация, как и у TVector, ведется с учетом StartIndex
 template <class ValType>
-class TMatrix : public TVector<TVector<ValType> >
+class TMatrixRow
 {
+  typedef typename std::remove_const<ValType>::type ElemType;
+protected:
+  ValType *pRow;     // первый хранимый элемент строки
+  TIndex Size;       // число хранимых элементов
+  TIndex StartIndex; // индекс первого хранимого элемента
+
+  const TMatrixRow& Assign(const ElemType *p, TIndex s, TIndex si) const; // копирование s элементов p
 public:
-  TMatrix(int s = 10);                           
-  TMatrix(const TMatrix &mt);                    // копирование
-  TMatrix(const TVector<TVector<ValType> > &mt); // преобразование типа
-  bool operator==(const TMatrix &mt) const;      // сравнение
-  bool operator!=(const TMatrix &mt) const;      // сравнение
-  TMatrix& operator= (const TMatrix &mt);        // присваивание
-  TMatrix  operator+ (const TMatrix &mt);        // сложение
-  TMatrix  operator- (const TMatrix &mt);        // вычитание
+  typedef ElemType value_type;
+  typedef ValType* iterator;
+  typedef ValType* const_iterator;
 
-  // ввод / вывод
-  friend istream& operator>>(istream &in, TMatrix &mt)
+  TMatrixRow(ValType *p, TIndex s, TIndex si) : pRow(p), Size(s), StartIndex(si) {}
+  TMatrixRow(const TMatrixRow &r) = default;
+  template <class OtherType,
+    class = std::enable_if_t<std::is_convertible<OtherType*, ValType*>::value> >
+  TMatrixRow(const TMatrixRow<OtherType> &r)       // неконстантная -> константная
+    : pRow(r.data()), Size(r.GetSize()), StartIndex(r.GetStartIndex()) {}
+  TIndex GetSize() const { return Size; }          // размер строки
+  TIndex GetStartIndex() const { return StartIndex; } // индекс первого элемента
+  ValType& operator[](TIndex pos) const;           // доступ
+  ValType& UncheckedAt(TIndex pos) const { return pRow[pos - StartIndex]; } // доступ без проверки
+  ValType* data() const { return pRow; }           // хранимые элементы [begin(), end())
+  iterator begin() const { return pRow; }
+  iterator end() const { return pRow + Size; }
+  // Присваивание копирует элементы, а не переставляет строку: a[0] = b[0]
+  // меняет матрицу a. Строки должны совпадать по размеру и первому индексу
+  const TMatrixRow& operator=(const TVector<ElemType> &v) const;
+  const TMatrixRow& operator=(const TMatrixRow &r) const;
+  template <class OtherType,
+    class = std::enable_if_t<std::is_convertible<OtherType*, const ElemType*>::value> >
+  const TMatrixRow& operator=(const TMatrixRow<OtherType> &r) const;
+  operator TVector<ElemType>() const;              // преобразование в вектор
+
+  // сравнение с вектором
+  friend bool operator==(const TMatrixRow &r, const TVector<ElemType> &v)
+  {
+	  if (r.Size != v.GetSize() || r.StartIndex != v.GetStartIndex())
+	  {
+		  return false;
+	  }
+	  for (TIndex i = 0; i < r.Size; ++i)
+	  {
+		  if (r.pRow[i] != v.UncheckedAt(r.StartIndex + i))
+		  {
+			  return false;
+		  }
+	  }
+	  return true;
+  }
+  friend bool operator==(const TVector<ElemType> &v, const TMatrixRow &r) { return r == v; }
+  friend bool operator!=(const TMatrixRow &r, const TVector<ElemType> &v) { return !(r == v); }
+  friend bool operator!=(const TVector<ElemType> &v, const TMatrixRow &r) { return !(r == v); }
+
+  // ввод-вывод
+  friend istream& operator>>(istream &in, const TMatrixRow &r)
   {
-	  for (int i = 0; i < mt.Size; i++)
-		  in >> mt.pVector[i];
+	  for (TIndex i = 0; i < r.Size; i++)
+		  in >> r.pRow[i];
 	  return in;
   }
-  friend ostream & operator<<(ostream &out, const TMatrix &mt)
+  friend ostream& operator<<(ostream &out, const TMatrixRow &r)
   {
-	  for (int i = 0; i < mt.Size; i++)
-		  out << mt.pVector[i] << endl;
+	  for (TIndex i = 0; i < r.StartIndex; ++i)
+	  {
+		  out << '\t';
+	  }
+	  for (TIndex i = 0; i < r.Size; i++)
+		  out << r.pRow[i] << '\t';
 	  return out;
   }
 };
 
-template <class ValType>
-TMatrix<ValType>::TMatrix(int s)
-	: TVector<TVector<ValType>>(s)
+template <class ValType> // доступ
+ValType& TMatrixRow<ValType>::operator[](TIndex pos) const
 {
-	if (Size < 0 || Size >= MAX_MATRIX_SIZE)
-	{
-		throw std::runtime_error("Invalid size for matrix");
-	}
-	for (int i = 0; i < GetSize(); ++i)
+	pos -= StartIndex;
+	if (CHECK_BOUNDS && (pos < 0 || pos >= Size))
 	{
-		pVector[i] = TVector<ValType>(s - i, i);
+		throw std::runtime_error("Invalid index in operator[]");
 	}
+	return pRow[pos];
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // конструктор копирования
-TMatrix<ValType>::TMatrix(const TMatrix<ValType> &mt)
-  : TMatrix((const TVector<TVector<ValType>>&)mt)
-{
-}
-
-template <class ValType> // конструктор преобразования типа
-TMatrix<ValType>::TMatrix(const TVector<TVector<ValType> > &mt)
-	: TVector<TVector<ValType> >(mt.GetSize())
+template <class ValType> // копирование элементов
+const TMatrixRow<ValType>& TMatrixRow<ValType>::operator=(const TVector<ElemType> &v) const
 {
-	if (Size < 0 || Size >= MAX_MATRIX_SIZE)
+	if (Size != v.GetSize() || StartIndex != v.GetStartIndex())
 	{
-		throw std::runtime_error("Invalid size for matrix");
+		throw std::runtime_error("Can't assign vector of different shape to matrix row");
 	}
-	for (int i = 0; i < GetSize(); ++i)
+	for (TIndex i = 0; i < Size; ++i)
 	{
-		(*this)[i] = mt[i];
+		pRow[i] = v.UncheckedAt(StartIndex + i);
 	}
-}
+	return *this;
+} /*-------------------------------------------------------------------------*/
 
-template <class ValType> // сравнение
-bool TMatrix<ValType>::operator==(const TMatrix<ValType> &mt) const
+template <class ValType> // копирование элементов строки
+const TMatrixRow<ValType>& TMatrixRow<ValType>::Assign(const ElemType *p, TIndex s, TIndex si) const
 {
-	if (GetSize() != mt.GetSize() || StartIndex != mt.StartIndex)
-	{
-		return false;
-	}
-
-	for (int i = 0; i < GetSize(); ++i)
+	if (Size != s || StartIndex != si)
 	{
-		if (pVector[i].GetSize() != mt.pVector[i].GetSize() || pVector[i].GetStartIndex() != mt.pVector[i].GetStartIndex())
-		{
-			return false;
-		}
-		for (int j = i; j < pVector[i].GetSize(); ++j)
-		{
-			if (pVector[i][j] != mt.pVector[i][j])
-			{
-				return false;
-			}
-		}
+		throw std::runtime_error("Can't assign row of different shape to matrix row");
 	}
-	return true;
+	std::copy(p, p + Size, pRow);
+	return *this;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // сравнение
-bool TMatrix<ValType>::operator!=(const TMatrix<ValType> &mt) const
+template <class ValType> // копирование элементов
+const TMatrixRow<ValType>& TMatrixRow<ValType>::operator=(const TMatrixRow<ValType> &r) const
 {
-	return !(*this == mt);
+	return Assign(r.pRow, r.Size, r.StartIndex);
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // присваивание
-TMatrix<ValType>& TMatrix<ValType>::operator=(const TMatrix<ValType> &mt)
+template <class ValType> // копирование элементов
+template <class OtherType, class>
+const TMatrixRow<ValType>& TMatrixRow<ValType>::operator=(const TMatrixRow<OtherType> &r) const
 {
-	if (this != &mt)
-	{
-		((TVector<TVector<ValType> >*)this)->operator=(mt);
-	}
-	return *this;
+	return Assign(r.data(), r.GetSize(), r.GetStartIndex());
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // сложение
-TMatrix<ValType> TMatrix<ValType>::operator+(const TMatrix<ValType> &mt)
+template <class ValType> // преобразование в вектор
+TMatrixRow<ValType>::operator TVector<ElemType>() const
 {
-	if (GetSize() != mt.GetSize())
+	TVector<ElemType> aResult(Size, StartIndex);
+	for (TIndex i = 0; i < Size; ++i)
 	{
-		throw std::runtime_error("Can't add matrix with different size");
-	}
-	TMatrix<ValType> aResult = *this;
-	for (int i = 0; i < GetSize(); ++i)
-	{
-		for (int j = i; j < GetSize(); ++j)
-		{
-			aResult[i][j] += mt[i][j];
-		}
+		aResult.UncheckedAt(StartIndex + i) = pRow[i];
 	}
 	return aResult;
 } /*-------------------------------------------------------------------------*/
 
-template <class ValType> // вычитание
-TMatrix<ValType> TMatrix<ValType>::operator-(const TMatrix<ValType> &mt)
+
+// Верхнетреугольная матрица
+//
+// Элементы хранятся построчно в одном выровненном буфере из n(n+1)/2
+// элементов: строка i занимает участок [RowOffset(i), RowOffset(i) + n - i)
+// и начинается с диагонального элемента.
+template <class ValType, class AllocType>
+class TMatrix : public TMatrixExpr<TMatrix<ValType, AllocType> >
 {
-	if (GetSize() != mt.GetSize())
-	{
-		throw std::runtime_error("Can't substract matrix with different size");
-	}
-	TMatrix<ValType> aResult = *this;
-	for (int i = 0; i < GetSize(); ++i)
-	{
-		for (int j = i; j < GetSize(); ++j)
-		{
-			aResult[i][j] -= mt[i][j];
-		}
-	}
-	return aResult;
-} /*-------------------------------------------------------------------------*/
+protected:
+  ValType *pMatrix; // общий буфер элементов
+  TIndex Size;      // порядок матрицы
+  AllocType Alloc;  // распределитель памяти (utmatrix_alloc.h)
+  std::unique_ptr<TExternalStorage> pStorage; // владелец внешнего буфера (utmatrix_mmap.h)
+  TSharedCount *pShared = nullptr; // счетчик общего буфера в режиме копирования при записи
+
+  static TIndex RowOffset(TIndex i, TIndex n) { return PackedRowOffset(i, n); } // смещение строки
+  static TIndex PackedSize(TIndex n) { return PackedCount(n); }         // число элементов
+  ValType* Allocate(TIndex n, TMatrixInit init = INIT_UNINITIALIZED); // буфер матрицы порядка n
+  void Free(ValType *p, TIndex n) // освобождение буфера матрицы: своего, общего или внешнего
+  {
+	  if (pStorage)
+		  pStorage.reset();
+	  else if (pShared == nullptr)
+		  FreeElements(Alloc, p, PackedSize(n));
+	  else
+	  {
+		  if (pShared->Count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		  {
+			  FreeElements(Alloc, p, PackedSize(n));
+			  delete pShared;
+		  }
+		  pShared = nullptr;
+	  }
+  }
+  void Reallocate(TIndex n);       // новый буфер порядка n; режим копирования при записи сохраняется
+  void Detach(bool keep = true);   // собственный буфер перед записью (keep - с копией элементов)
+  void Leak();                     // собственный буфер, который больше не разделяется
+  bool IsShareable() const { return pShared != nullptr && !pShared->Unshareable; }
+  // матрица над внешним буфером p, которым владеет pStore
+  TMatrix(TExternalStorage *pStore, ValType *p, TIndex n, const AllocType &alloc);
+
+  // вычисление выражения в буфер; простые выражения сводятся к
+  // векторизованным ядрам (utmatrix_simd.h)
+  template <class ExprType>
+  void Evaluate(const ExprType &e);
+  void Evaluate(const TMatrixBinary<TMatrix, TMatrix, TAddOp> &e);
+  void Evaluate(const TMatrixBinary<TMatrix, TMatrix, TSubOp> &e);
+  void Evaluate(const TMatrixScalar<TMatrix, TMulOp> &e);
+  // f(kb, ke) для участков буфера матрицы порядка n из целых строк; при
+  // нескольких потоках (utmatrix_threads.h) участки содержат поровну
+  // элементов и каждый раз достаются одним и тем же потокам
+  template <class FuncType>
+  static void ForEachRowBlock(TIndex n, FuncType f);
+
+  // умножение C += A * B упакованных треугольников порядка n
+  template <class Type>
+  static Type* RowPtr(Type *p, TIndex i, TIndex n) { return p + RowOffset(i, n) - i; } // RowPtr[j] = (i, j)
+  static void MultiplySimple(const ValType *pA, const ValType *pB, ValType *pC, TIndex n);
+  static void MultiplyBlocked(const ValType *pA, const ValType *pB, ValType *pC, TIndex n);
+  static void MultiplyBlock(const ValType *pA, const ValType *pB, ValType *pC, TIndex n,
+    TIndex ib, TIndex ie, TIndex kb, TIndex ke, TIndex jb, TIndex je);
+public:
+  typedef ValType ValueType;
+
+  TMatrix(TIndex s = 10, TMatrixInit init = INIT_UNINITIALIZED, const AllocType &alloc = AllocType());
+  TMatrix(const TMatrix &mt);                    // копирование
+  TMatrix(TMatrix &&mt) noexcept;                // перемещение
+  template <class ExprType>
+  TMatrix(const TMatrixExpr<ExprType> &e, const AllocType &alloc = AllocType()); // вычисление выражения
+  TMatrix(const TVector<TVector<ValType> > &mt); // преобразование типа
+  ~TMatrix();
+  const AllocType& GetAllocator() const { return Alloc; }
+
+  // Матрица над отображенным в память файлом из n(n+1)/2 упакованных
+  // элементов: создание не читает файл, копия матрицы хранится в памяти,
+  // присваивание матрицы другого порядка отключает отображение
+  static TMatrix MapFile(const std::string &path, TMapMode mode = MAP_READ_ONLY,
+    const AllocType &alloc = AllocType());
+  static TMatrix CreateMappedFile(const std::string &path, TIndex n,
+    const AllocType &alloc = AllocType());               // новый файл, MAP_READ_WRITE
+  bool IsMapped() const { return pStorage != nullptr; }
+  void Sync();                                         // записать изменения в файл (msync)
+
+  // Режим копирования при записи: копии матрицы (и копии копий) разделяют
+  // буфер со счетчиком ссылок, и матрица получает собственный буфер при
+  // первом изменении - присваивании, операции на месте или ReadText. Копии
+  // можно передавать другим потокам.
+  // Неконстантные operator[], UncheckedAt и View() выдают изменяемые строки,
+  // ссылки и представления, поэтому всегда отделяют буфер и делают его
+  // неразделяемым: пока буфер матрицы не заменен (присваиванием матрицы
+  // другого порядка или разделяемой матрицы), ее копии копируют элементы
+  // сразу, и запись через выданные строки и ссылки не видна в копиях.
+  // Чтение без копирования - через константную ссылку на матрицу.
+  // Строки и ссылки, полученные до включения режима, не учитываются
+  void SetCopyOnWrite(bool on);
+  bool IsCopyOnWrite() const { return pShared != nullptr; }
+
+  // Вся матрица как треугольное представление (utmatrix_view.h); его
+  // Leading, Trailing, Block, Column и Diagonal дают части без копирования
+  TTriangleView<ValType> View() { Leak(); return TTriangleView<ValType>(pMatrix, Size, 0, Size); }
+  TTriangleView<const ValType> View() const { return TTriangleView<const ValType>(pMatrix, Size, 0, Size); }
+
+  // Двоичный формат (utmatrix_binary.h); потоки открываются в режиме binary.
+  // MapBinary отображает файл только для чтения (изменения остаются в
+  // памяти процесса) и не читает данные, если не требуется сверить
+  // контрольную сумму (verify)
+  void SaveBinary(std::ostream &out) const;
+  static TMatrix LoadBinary(std::istream &in, const AllocType &alloc = AllocType());
+  static TMatrix MapBinary(const std::string &path, bool verify = false,
+    const AllocType &alloc = AllocType());
+
+  // Текст через to_chars / from_chars (utmatrix_text.h); TEXT_TRIANGLE -
+  // расположение operator<< и operator>>, TEXT_FULL - все n элементов строки
+  void WriteText(std::ostream &out, TTextLayout layout = TEXT_TRIANGLE) const;
+  void ReadText(std::istream &in, TTextLayout layout = TEXT_TRIANGLE);
+  // Чтение файла с текстом в формате ReadText несколькими потоками
+  // (utmatrix_threads.h): файл отображается в память и делится на участки
+  // из целых строк, каждая строка матрицы разбирается прямо в свое место
+  // буфера. Ошибка сообщает строку и столбец матрицы
+  void ReadTextFile(const std::string &path, TTextLayout layout = TEXT_TRIANGLE);
+  TIndex GetSize() const { return Size; }        // порядок матрицы
+  TMatrixRow<ValType> operator[](TIndex pos);    // доступ к строке
+  TMatrixRow<const ValType> operator[](TIndex pos) const;
+  ValType& UncheckedAt(TIndex i, TIndex j) { Leak(); return pMatrix[RowOffset(i, Size) + j - i]; } // элемент (i, j) без проверки
+  const ValType& UncheckedAt(TIndex i, TIndex j) const { return pMatrix[RowOffset(i, Size) + j - i]; }
+  bool operator==(const TMatrix &mt) const;      // сравнение
+  bool operator!=(const TMatrix &mt) const;      // сравнение
+  TMatrix& operator= (const TMatrix &mt);        // присваивание
+  TMatrix& operator= (TMatrix &&mt) noexcept;    // перемещающее присваивание
+  template <class ExprType>
+  TMatrix& operator= (const TMatrixExpr<ExprType> &e); // присваивание выражения
+  void swap(TMatrix &mt) noexcept;               // обмен содержимым
+  friend void swap(TMatrix &mt1, TMatrix &mt2) noexcept { mt1.swap(mt2); }
+  const ValType& Eval(TIndex k) const { return pMatrix[k]; } // элемент для выражений
+
+  // операции на месте, без выделения памяти
+  template <class ExprType>
+  TMatrix& operator+=(const TMatrixExpr<ExprType> &e); // прибавить матрицу
+  template <class ExprType>
+  TMatrix& operator-=(const TMatrixExpr<ExprType> &e); // вычесть матрицу
+  TMatrix& operator+=(const TMatrix &mt);
+  TMatrix& operator-=(const TMatrix &mt);
+  TMatrix& operator*=(const ValType &val);       // умножить на скаляр
+  TMatrix& operator/=(const ValType &val);       // разделить на скаляр
+  TMatrix& Axpy(const ValType &alpha, const TMatrix &mt); // this += alpha * mt
+
+  // Операции над постоянными матрицами строят выражения (utmatrix_expr.h);
+  // для временного операнда результат сразу вычисляется в его буфере
+  TMatrix  operator+ (const TMatrix &mt) &&;     // сложение
+  TMatrix  operator- (const TMatrix &mt) &&;     // вычитание
+  TMatrix  operator* (const ValType &val) &&;    // умножить на скаляр
+  template <class Type, class AllocT>
+  friend TMatrix<Type, AllocT> operator*(const TMatrix<Type, AllocT> &mt1, const TMatrix<Type, AllocT> &mt2); // умножение
+  template <class Type, class AllocT, class VecAllocT>
+  friend TVector<Type, VecAllocT> operator*(const TMatrix<Type, AllocT> &mt, const TVector<Type, VecAllocT> &v); // A * x
+  template <class Type, class AllocT, class VecAllocT>
+  friend TVector<Type, VecAllocT> operator*(const TVector<Type, VecAllocT> &v, const TMatrix<Type, AllocT> &mt); // x * A
+  template <class Type, class AllocT, class VecAllocT>
+  friend void Solve(const TMatrix<Type, AllocT> &mt, TVector<Type, VecAllocT> &b); // A x = b
+  template <class Type, class AllocT, class VecAllocT, class OuterAllocT>
+  friend void Solve(const TMatrix<Type, AllocT> &mt, TVector<TVector<Type, VecAllocT>, OuterAllocT> &rhs); // A X = B
+
+  // ввод / вывод
+  friend istream& operator>>(istream &in, TMatrix &mt)
+  {
+	  for (TIndex i = 0; i < mt.Size; i++)
+		  in >> mt[i];
+	  return in;
+  }
+  friend ostream & operator<<(ostream &out, const TMatrix &mt)
+  {
+	  for (TIndex i = 0; i < mt.Size; i++)
+		  out << mt[i] << '\n';
+	  return out;
+  }
+};
+
+template <class ValType, class AllocType> // выделение буфера
+ValType* TMatrix<ValType, AllocType>::Allocate(TIndex n, TMatrixInit init)
+{
+	if constexpr (THasPagePolicy<AllocType>::value && std::is_arithmetic<ValType>::value)
+	{
+		if (Alloc.GetPagePolicy() == PAGES_HUGE_FIRST_TOUCH)
+		{
+			// первое обращение к странице размещает ее в памяти узла NUMA
+			// обратившегося потока; полосы совпадают с поэлементными операциями
+			ValType *p = std::allocator_traits<AllocType>::allocate(Alloc, PackedSize(n));
+			ForEachRowBlock(n, [&](TIndex kb, TIndex ke)
+			{
+				std::fill(p + kb, p + ke, ValType());
+			});
+			return p;
+		}
+	}
+	return AllocateElements(Alloc, PackedSize(n), init == INIT_ZERO);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+TMatrix<ValType, AllocType>::TMatrix(TIndex s, TMatrixInit init, const AllocType &alloc)
+	: Size(s), Alloc(alloc)
+{
+	if (Size <= 0 || Size >= MAX_MATRIX_SIZE)
+	{
+		throw std::runtime_error("Invalid size for matrix");
+	}
+	pMatrix = Allocate(Size, init);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // матрица над внешним буфером
+TMatrix<ValType, AllocType>::TMatrix(TExternalStorage *pStore, ValType *p, TIndex n, const AllocType &alloc)
+	: pMatrix(p), Size(n), Alloc(alloc), pStorage(pStore)
+{
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // отображение файла
+TMatrix<ValType, AllocType> TMatrix<ValType, AllocType>::MapFile(const std::string &path, TMapMode mode,
+	const AllocType &alloc)
+{
+	static_assert(std::is_trivially_copyable<ValType>::value, "Only trivially copyable elements can be mapped");
+	std::unique_ptr<TMappedFile> pFile(new TMappedFile(path, mode));
+	// порядок n по числу элементов n(n+1)/2
+	const size_t count = pFile->GetLength() / sizeof(ValType);
+	const TIndex n = (TIndex)((std::sqrt(8.0 * (double)count + 1) - 1) / 2 + 0.5);
+	if (pFile->GetLength() % sizeof(ValType) != 0 || n <= 0 || n >= MAX_MATRIX_SIZE ||
+		(size_t)PackedSize(n) != count)
+	{
+		throw std::runtime_error("Can't map file with size not matching packed matrix");
+	}
+	ValType *p = reinterpret_cast<ValType*>(pFile->GetData());
+	return TMatrix(pFile.release(), p, n, alloc);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // создание файла и его отображение
+TMatrix<ValType, AllocType> TMatrix<ValType, AllocType>::CreateMappedFile(const std::string &path, TIndex n,
+	const AllocType &alloc)
+{
+	static_assert(std::is_trivially_copyable<ValType>::value, "Only trivially copyable elements can be mapped");
+	if (n <= 0 || n >= MAX_MATRIX_SIZE)
+	{
+		throw std::runtime_error("Invalid size for matrix");
+	}
+	std::unique_ptr<TMappedFile> pFile(new TMappedFile(path, MAP_READ_WRITE, PackedSize(n) * sizeof(ValType)));
+	ValType *p = reinterpret_cast<ValType*>(pFile->GetData());
+	return TMatrix(pFile.release(), p, n, alloc);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // запись изменений в файл
+void TMatrix<ValType, AllocType>::Sync()
+{
+	if (pStorage)
+	{
+		pStorage->Sync();
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // запись в двоичном формате
+void TMatrix<ValType, AllocType>::SaveBinary(std::ostream &out) const
+{
+	WriteBinary(out, MakeBinaryHeader(LAYOUT_UPPER_PACKED, Size, 0, pMatrix, PackedSize(Size)), pMatrix);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // чтение из двоичного формата
+TMatrix<ValType, AllocType> TMatrix<ValType, AllocType>::LoadBinary(std::istream &in, const AllocType &alloc)
+{
+	const TBinaryHeader h = ReadBinaryHeader(in);
+	CheckBinaryHeader<ValType>(h, LAYOUT_UPPER_PACKED);
+	if (h.Size <= 0 || h.Size >= MAX_MATRIX_SIZE ||
+		h.DataSize != (uint64_t)PackedSize((TIndex)h.Size) * sizeof(ValType))
+	{
+		throw std::runtime_error("Can't load matrix with invalid size");
+	}
+	TMatrix mt((TIndex)h.Size, INIT_UNINITIALIZED, alloc);
+	ReadBinaryData(in, h, mt.pMatrix);
+	return mt;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // отображение файла в двоичном формате
+TMatrix<ValType, AllocType> TMatrix<ValType, AllocType>::MapBinary(const std::string &path, bool verify,
+	const AllocType &alloc)
+{
+	std::unique_ptr<TMappedFile> pFile(new TMappedFile(path, MAP_READ_ONLY));
+	TBinaryHeader h;
+	if (pFile->GetLength() < sizeof(h))
+	{
+		throw std::runtime_error("Can't read binary header");
+	}
+	std::memcpy(&h, pFile->GetData(), sizeof(h));
+	CheckBinaryHeader<ValType>(h, LAYOUT_UPPER_PACKED);
+	if (h.Size <= 0 || h.Size >= MAX_MATRIX_SIZE ||
+		h.DataSize != (uint64_t)PackedSize((TIndex)h.Size) * sizeof(ValType) ||
+		h.DataSize > pFile->GetLength() - h.HeaderSize)
+	{
+		throw std::runtime_error("Can't load matrix with invalid size");
+	}
+	ValType *p = reinterpret_cast<ValType*>(pFile->GetData() + h.HeaderSize);
+	if (verify && BinaryChecksum(p, h.DataSize) != h.Checksum)
+	{
+		throw std::runtime_error("Can't load data with wrong checksum");
+	}
+	return TMatrix(pFile.release(), p, (TIndex)h.Size, alloc);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вывод текста
+void TMatrix<ValType, AllocType>::WriteText(std::ostream &out, TTextLayout layout) const
+{
+	TTextWriter writer(out);
+	const ValType *p = pMatrix;
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		for (TIndex j = 0; j < i; ++j)
+		{
+			if (layout == TEXT_FULL)
+			{
+				writer.Write(ValType());
+			}
+			writer.Put('\t');
+		}
+		for (TIndex j = i; j < Size; ++j)
+		{
+			writer.Write(*p++);
+			writer.Put('\t');
+		}
+		writer.Put('\n');
+	}
+	writer.Flush();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // ввод текста
+void TMatrix<ValType, AllocType>::ReadText(std::istream &in, TTextLayout layout)
+{
+	Detach();
+	TTextReader reader(in);
+	ValType *p = pMatrix;
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		for (TIndex j = 0; layout == TEXT_FULL && j < i; ++j)
+		{
+			ValType val;
+			reader.Read(val);
+			if (val != ValType())
+			{
+				throw std::runtime_error("Can't read matrix with nonzero elements below diagonal");
+			}
+		}
+		for (TIndex j = i; j < Size; ++j)
+		{
+			reader.Read(*p++);
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // параллельное чтение текстового файла
+void TMatrix<ValType, AllocType>::ReadTextFile(const std::string &path, TTextLayout layout)
+{
+	TMappedFile file(path, MAP_READ_ONLY);
+	const char *pText = file.GetData();
+	const size_t length = file.GetLength();
+	// участки [aBegin[t], aBegin[t + 1]) начинаются с начала строки текста
+	const int parts = length < (size_t)PARALLEL_MIN_ELEMENTS ? 1 : 4 * GetThreadCount();
+	std::vector<size_t> aBegin(parts + 1, length);
+	aBegin[0] = 0;
+	for (int t = 1; t < parts; ++t)
+	{
+		size_t pos = std::max(aBegin[t - 1], length / parts * t);
+		const void *pLineEnd = pos < length ? std::memchr(pText + pos, '\n', length - pos) : nullptr;
+		aBegin[t] = pLineEnd ? static_cast<const char*>(pLineEnd) - pText + 1 : length;
+	}
+	// номер строки в начале каждого участка
+	std::vector<TIndex> aRow(parts + 1, 0);
+	ThreadPool().Run(parts, [&](int t)
+	{
+		aRow[t + 1] = (TIndex)std::count(pText + aBegin[t], pText + aBegin[t + 1], '\n');
+	});
+	for (int t = 0; t < parts; ++t)
+	{
+		aRow[t + 1] += aRow[t];
+	}
+	const TIndex lines = aRow[parts] + (pText[length - 1] != '\n' ? 1 : 0);
+	if (lines < Size)
+	{
+		throw std::runtime_error("Can't read matrix: too few rows in " + path);
+	}
+	Detach();
+	ThreadPool().Run(parts, [&](int t)
+	{
+		const char *p = pText + aBegin[t];
+		const char *pEnd = pText + aBegin[t + 1];
+		auto error = [&](const char *what, TIndex i, TIndex j)
+		{
+			return std::runtime_error(std::string("Can't read matrix: ") + what + " at row " +
+				std::to_string(i) + ", column " + std::to_string(j) + " in " + path);
+		};
+		for (TIndex i = aRow[t]; p < pEnd; ++i)
+		{
+			const char *pLineEnd = static_cast<const char*>(std::memchr(p, '\n', pEnd - p));
+			if (pLineEnd == nullptr)
+			{
+				pLineEnd = pEnd;
+			}
+			if (i < Size)
+			{
+				ValType *pRow = RowPtr(pMatrix, i, Size);
+				for (TIndex j = layout == TEXT_FULL ? 0 : i; j < Size; ++j)
+				{
+					while (p < pLineEnd && IsTextSpace(*p))
+						++p;
+					const char *pToken = p;
+					while (p < pLineEnd && !IsTextSpace(*p))
+						++p;
+					if (pToken == p)
+					{
+						throw error("missing element", i, j);
+					}
+					ValType val;
+					if (!ParseNumber(pToken, p, val))
+					{
+						throw error("invalid number", i, j);
+					}
+					if (j >= i)
+					{
+						pRow[j] = val;
+					}
+					else if (val != ValType())
+					{
+						throw error("nonzero element below diagonal", i, j);
+					}
+				}
+			}
+			while (p < pLineEnd && IsTextSpace(*p))
+				++p;
+			if (p != pLineEnd)
+			{
+				throw error(i < Size ? "extra element" : "extra row", i, i < Size ? Size : 0);
+			}
+			p = pLineEnd + 1;
+		}
+	});
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // замена буфера новым
+void TMatrix<ValType, AllocType>::Reallocate(TIndex n)
+{
+	std::unique_ptr<TSharedCount> pNewShared(pShared != nullptr ? new TSharedCount : nullptr);
+	ValType *p = Allocate(n);
+	Free(pMatrix, Size);
+	pMatrix = p;
+	Size = n;
+	pShared = pNewShared.release();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // отделение от общего буфера
+void TMatrix<ValType, AllocType>::Detach(bool keep)
+{
+	if (pShared == nullptr || pShared->Count.load(std::memory_order_acquire) == 1)
+	{
+		return;
+	}
+	std::unique_ptr<TSharedCount> pNewShared(new TSharedCount);
+	ValType *p = Allocate(Size);
+	if (keep)
+	{
+		try
+		{
+			CopyElements(p, pMatrix, PackedSize(Size));
+		}
+		catch (...)
+		{
+			FreeElements(Alloc, p, PackedSize(Size));
+			throw;
+		}
+	}
+	Free(pMatrix, Size);
+	pMatrix = p;
+	pShared = pNewShared.release();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // буфер для изменяемых строк и ссылок
+void TMatrix<ValType, AllocType>::Leak()
+{
+	Detach();
+	if (pShared != nullptr)
+	{
+		pShared->Unshareable = true;
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // режим копирования при записи
+void TMatrix<ValType, AllocType>::SetCopyOnWrite(bool on)
+{
+	if (on && pShared == nullptr)
+	{
+		if (pStorage)
+		{
+			throw std::runtime_error("Can't share buffer of mapped matrix");
+		}
+		pShared = new TSharedCount;
+	}
+	else if (!on && pShared != nullptr)
+	{
+		Detach();
+		delete pShared;
+		pShared = nullptr;
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // конструктор копирования
+TMatrix<ValType, AllocType>::TMatrix(const TMatrix<ValType, AllocType> &mt)
+	: Size(mt.Size),
+	  Alloc(std::allocator_traits<AllocType>::select_on_container_copy_construction(mt.Alloc))
+{
+	if (mt.IsShareable() && Alloc == mt.Alloc)
+	{
+		// общий буфер освобождает последняя из разделяющих его матриц
+		mt.pShared->Count.fetch_add(1, std::memory_order_relaxed);
+		pMatrix = mt.pMatrix;
+		pShared = mt.pShared;
+		return;
+	}
+	std::unique_ptr<TSharedCount> pNewShared(mt.pShared != nullptr ? new TSharedCount : nullptr);
+	pMatrix = Allocate(Size);
+	try
+	{
+		CopyElements(pMatrix, mt.pMatrix, PackedSize(Size));
+	}
+	catch (...)
+	{
+		Free(pMatrix, Size);
+		throw;
+	}
+	pShared = pNewShared.release();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // конструктор перемещения
+TMatrix<ValType, AllocType>::TMatrix(TMatrix<ValType, AllocType> &&mt) noexcept
+	: pMatrix(mt.pMatrix), Size(mt.Size), Alloc(mt.Alloc), pStorage(std::move(mt.pStorage)), pShared(mt.pShared)
+{
+	mt.pMatrix = nullptr;
+	mt.Size = 0;
+	mt.pShared = nullptr;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычисление выражения
+template <class ExprType>
+TMatrix<ValType, AllocType>::TMatrix(const TMatrixExpr<ExprType> &e, const AllocType &alloc)
+	: Size(e.Self().GetSize()), Alloc(alloc)
+{
+	pMatrix = Allocate(Size);
+	try
+	{
+		Evaluate(e.Self());
+	}
+	catch (...)
+	{
+		Free(pMatrix, Size);
+		throw;
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // конструктор преобразования типа
+TMatrix<ValType, AllocType>::TMatrix(const TVector<TVector<ValType> > &mt)
+	: Size(mt.GetSize())
+{
+	if (Size <= 0 || Size >= MAX_MATRIX_SIZE)
+	{
+		throw std::runtime_error("Invalid size for matrix");
+	}
+	pMatrix = Allocate(Size);
+	try
+	{
+		for (TIndex i = 0; i < Size; ++i)
+		{
+			for (TIndex j = i; j < Size; ++j)
+			{
+				pMatrix[RowOffset(i, Size) + j - i] = mt[i][j];
+			}
+		}
+	}
+	catch (...)
+	{
+		Free(pMatrix, Size);
+		throw;
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+TMatrix<ValType, AllocType>::~TMatrix()
+{
+	Free(pMatrix, Size);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // доступ к строке
+TMatrixRow<ValType> TMatrix<ValType, AllocType>::operator[](TIndex pos)
+{
+	if (CHECK_BOUNDS && (pos < 0 || pos >= Size))
+	{
+		throw std::runtime_error("Invalid index in operator[]");
+	}
+	Leak();
+	return TMatrixRow<ValType>(pMatrix + RowOffset(pos, Size), Size - pos, pos);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // доступ к строке
+TMatrixRow<const ValType> TMatrix<ValType, AllocType>::operator[](TIndex pos) const
+{
+	if (CHECK_BOUNDS && (pos < 0 || pos >= Size))
+	{
+		throw std::runtime_error("Invalid index in operator[]");
+	}
+	return TMatrixRow<const ValType>(pMatrix + RowOffset(pos, Size), Size - pos, pos);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // сравнение
+bool TMatrix<ValType, AllocType>::operator==(const TMatrix<ValType, AllocType> &mt) const
+{
+	if (Size != mt.Size)
+	{
+		return false;
+	}
+	for (TIndex k = 0; k < PackedSize(Size); ++k)
+	{
+		if (pMatrix[k] != mt.pMatrix[k])
+		{
+			return false;
+		}
+	}
+	return true;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // сравнение
+bool TMatrix<ValType, AllocType>::operator!=(const TMatrix<ValType, AllocType> &mt) const
+{
+	return !(*this == mt);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // присваивание
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator=(const TMatrix<ValType, AllocType> &mt)
+{
+	if (this == &mt || (pShared != nullptr && pMatrix == mt.pMatrix))
+	{
+		return *this;
+	}
+	// внешний буфер (отображенный файл) не заменяется общим: элементы
+	// копируются в него, как и без режима копирования при записи
+	if (mt.IsShareable() && Alloc == mt.Alloc && !pStorage)
+	{
+		mt.pShared->Count.fetch_add(1, std::memory_order_relaxed);
+		Free(pMatrix, Size);
+		pMatrix = mt.pMatrix;
+		Size = mt.Size;
+		pShared = mt.pShared;
+		return *this;
+	}
+	if (Size != mt.Size)
+	{
+		Reallocate(mt.Size);
+	}
+	else
+	{
+		Detach(false);
+	}
+	CopyElements(pMatrix, mt.pMatrix, PackedSize(Size));
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // присваивание выражения
+template <class ExprType>
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator=(const TMatrixExpr<ExprType> &e)
+{
+	const ExprType &expr = e.Self();
+	if (Size != expr.GetSize())
+	{
+		// матрица другого порядка не может быть операндом выражения
+		Reallocate(expr.GetSize());
+	}
+	else
+	{
+		// выражение может читать и эту матрицу
+		Detach();
+	}
+	Evaluate(expr);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычисление выражения в буфер
+template <class ExprType>
+void TMatrix<ValType, AllocType>::Evaluate(const ExprType &e)
+{
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		for (TIndex k = kb; k < ke; ++k)
+		{
+			pMatrix[k] = e.Eval(k);
+		}
+	});
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+void TMatrix<ValType, AllocType>::Evaluate(const TMatrixBinary<TMatrix, TMatrix, TAddOp> &e)
+{
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		VecAdd(pMatrix + kb, e.GetLeft().pMatrix + kb, e.GetRight().pMatrix + kb, ke - kb);
+	});
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+void TMatrix<ValType, AllocType>::Evaluate(const TMatrixBinary<TMatrix, TMatrix, TSubOp> &e)
+{
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		VecSub(pMatrix + kb, e.GetLeft().pMatrix + kb, e.GetRight().pMatrix + kb, ke - kb);
+	});
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType>
+void TMatrix<ValType, AllocType>::Evaluate(const TMatrixScalar<TMatrix, TMulOp> &e)
+{
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		VecMulScalar(pMatrix + kb, e.GetExpr().pMatrix + kb, e.GetValue(), ke - kb);
+	});
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // обход буфера полосами строк
+template <class FuncType>
+void TMatrix<ValType, AllocType>::ForEachRowBlock(TIndex n, FuncType f)
+{
+	const TIndex count = PackedSize(n);
+	const int threads = GetThreadCount();
+	if (threads <= 1 || count < PARALLEL_MIN_ELEMENTS)
+	{
+		f(0, count);
+		return;
+	}
+	const std::vector<TIndex> aRows = SplitTriangleRows(n, threads);
+	ThreadPool().RunPinned(threads, [&](int t)
+	{
+		f(RowOffset(aRows[t], n), RowOffset(aRows[t + 1], n));
+	});
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // перемещающее присваивание
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator=(TMatrix<ValType, AllocType> &&mt) noexcept
+{
+	TMatrix<ValType, AllocType> aTemp(std::move(mt));
+	swap(aTemp);
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // обмен содержимым
+void TMatrix<ValType, AllocType>::swap(TMatrix<ValType, AllocType> &mt) noexcept
+{
+	std::swap(pMatrix, mt.pMatrix);
+	std::swap(Size, mt.Size);
+	std::swap(Alloc, mt.Alloc);
+	std::swap(pStorage, mt.pStorage);
+	std::swap(pShared, mt.pShared);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // прибавить матрицу
+template <class ExprType>
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator+=(const TMatrixExpr<ExprType> &e)
+{
+	const ExprType &expr = e.Self();
+	if (Size != expr.GetSize())
+	{
+		throw std::runtime_error("Can't add matrix with different size");
+	}
+	Detach();
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		for (TIndex k = kb; k < ke; ++k)
+		{
+			pMatrix[k] += expr.Eval(k);
+		}
+	});
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычесть матрицу
+template <class ExprType>
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator-=(const TMatrixExpr<ExprType> &e)
+{
+	const ExprType &expr = e.Self();
+	if (Size != expr.GetSize())
+	{
+		throw std::runtime_error("Can't substract matrix with different size");
+	}
+	Detach();
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		for (TIndex k = kb; k < ke; ++k)
+		{
+			pMatrix[k] -= expr.Eval(k);
+		}
+	});
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // прибавить матрицу
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator+=(const TMatrix<ValType, AllocType> &mt)
+{
+	if (Size != mt.Size)
+	{
+		throw std::runtime_error("Can't add matrix with different size");
+	}
+	Detach();
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		VecAdd(pMatrix + kb, pMatrix + kb, mt.pMatrix + kb, ke - kb);
+	});
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычесть матрицу
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator-=(const TMatrix<ValType, AllocType> &mt)
+{
+	if (Size != mt.Size)
+	{
+		throw std::runtime_error("Can't substract matrix with different size");
+	}
+	Detach();
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		VecSub(pMatrix + kb, pMatrix + kb, mt.pMatrix + kb, ke - kb);
+	});
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // умножить на скаляр
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator*=(const ValType &val)
+{
+	Detach();
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		VecMulScalar(pMatrix + kb, pMatrix + kb, val, ke - kb);
+	});
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // разделить на скаляр
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::operator/=(const ValType &val)
+{
+	Detach();
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		for (TIndex k = kb; k < ke; ++k)
+		{
+			pMatrix[k] /= val;
+		}
+	});
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // Y += alpha * X
+TMatrix<ValType, AllocType>& TMatrix<ValType, AllocType>::Axpy(const ValType &alpha, const TMatrix<ValType, AllocType> &mt)
+{
+	if (Size != mt.Size)
+	{
+		throw std::runtime_error("Can't add matrix with different size");
+	}
+	Detach();
+	ForEachRowBlock(Size, [&](TIndex kb, TIndex ke)
+	{
+		VecAxpy(pMatrix + kb, alpha, mt.pMatrix + kb, ke - kb);
+	});
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // сложение
+TMatrix<ValType, AllocType> TMatrix<ValType, AllocType>::operator+(const TMatrix<ValType, AllocType> &mt) &&
+{
+	return std::move(*this += mt);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вычитание
+TMatrix<ValType, AllocType> TMatrix<ValType, AllocType>::operator-(const TMatrix<ValType, AllocType> &mt) &&
+{
+	return std::move(*this -= mt);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // умножить на скаляр
+TMatrix<ValType, AllocType> TMatrix<ValType, AllocType>::operator*(const ValType &val) &&
+{
+	return std::move(*this *= val);
+} /*-------------------------------------------------------------------------*/
+
+// Произведение верхнетреугольных матриц верхнетреугольно:
+// C(i, j) = sum A(i, k) * B(k, j), i <= k <= j, около n^3/6 умножений.
+// Строки обходятся в порядке i-k-j, так что внутренний цикл - это axpy по
+// непрерывному участку строки B(k, *) в строку C(i, *).
+
+template <class ValType, class AllocType> // умножение без разбиения на блоки
+void TMatrix<ValType, AllocType>::MultiplySimple(const ValType *pA, const ValType *pB, ValType *pC, TIndex n)
+{
+	for (TIndex i = 0; i < n; ++i)
+	{
+		const ValType *a = RowPtr(pA, i, n);
+		ValType *c = RowPtr(pC, i, n);
+		for (TIndex k = i; k < n; ++k)
+		{
+			const ValType aik = a[k];
+			const ValType *b = RowPtr(pB, k, n);
+			for (TIndex j = k; j < n; ++j)
+			{
+				c[j] += aik * b[j];
+			}
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // вклад блока A(I, K) * B(K, J) в C(I, J)
+void TMatrix<ValType, AllocType>::MultiplyBlock(const ValType *pA, const ValType *pB, ValType *pC, TIndex n,
+	TIndex ib, TIndex ie, TIndex kb, TIndex ke, TIndex jb, TIndex je)
+{
+	const ValType *a = pA, *b = pB;
+	TIndex i = ib;
+	// по четыре строки C: каждая загруженная строка B используется четырежды
+	for (; i + 4 <= ie; i += 4)
+	{
+		const ValType *a0 = RowPtr(a, i, n), *a1 = RowPtr(a, i + 1, n);
+		const ValType *a2 = RowPtr(a, i + 2, n), *a3 = RowPtr(a, i + 3, n);
+		ValType *c0 = RowPtr(pC, i, n), *c1 = RowPtr(pC, i + 1, n);
+		ValType *c2 = RowPtr(pC, i + 2, n), *c3 = RowPtr(pC, i + 3, n);
+		TIndex k = std::max(kb, i);
+		// у диагонального блока первые k задевают не все четыре строки
+		for (; k < ke && k < i + 3; ++k)
+		{
+			const ValType *bk = RowPtr(b, k, n);
+			const TIndex js = std::max(jb, k);
+			for (TIndex r = 0; r <= k - i; ++r)
+			{
+				const ValType aik = RowPtr(a, i + r, n)[k];
+				ValType *c = RowPtr(pC, i + r, n);
+				for (TIndex j = js; j < je; ++j)
+				{
+					c[j] += aik * bk[j];
+				}
+			}
+		}
+		for (; k < ke; ++k)
+		{
+			const TIndex js = std::max(jb, k);
+			const ValType aAlpha[4] = { a0[k], a1[k], a2[k], a3[k] };
+			ValType *const aRows[4] = { c0 + js, c1 + js, c2 + js, c3 + js };
+			VecAxpy4(aRows, aAlpha, RowPtr(b, k, n) + js, je - js);
+		}
+	}
+	for (; i < ie; ++i)
+	{
+		const ValType *ai = RowPtr(a, i, n);
+		ValType *c = RowPtr(pC, i, n);
+		for (TIndex k = std::max(kb, i); k < ke; ++k)
+		{
+			const ValType aik = ai[k];
+			const ValType *bk = RowPtr(b, k, n);
+			const TIndex js = std::max(jb, k);
+			VecAxpy(c + js, aik, bk + js, je - js);
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // умножение по блокам
+void TMatrix<ValType, AllocType>::MultiplyBlocked(const ValType *pA, const ValType *pB, ValType *pC, TIndex n)
+{
+	// блоки ниже диагонали нулевые: перебираются только I <= K <= J
+	for (TIndex ib = 0; ib < n; ib += TRMM_BLOCK_SIZE)
+	{
+		const TIndex ie = std::min(ib + TRMM_BLOCK_SIZE, n);
+		for (TIndex kb = ib; kb < n; kb += TRMM_BLOCK_SIZE)
+		{
+			const TIndex ke = std::min(kb + TRMM_BLOCK_SIZE, n);
+			for (TIndex jb = kb; jb < n; jb += TRMM_BLOCK_SIZE)
+			{
+				const TIndex je = std::min(jb + TRMM_BLOCK_SIZE, n);
+				MultiplyBlock(pA, pB, pC, n, ib, ie, kb, ke, jb, je);
+			}
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType> // умножение
+TMatrix<ValType, AllocType> operator*(const TMatrix<ValType, AllocType> &mt1, const TMatrix<ValType, AllocType> &mt2)
+{
+	typedef TMatrix<ValType, AllocType> TMatrixType;
+	if (mt1.Size != mt2.Size)
+	{
+		throw std::runtime_error("Can't multiply matrix with different size");
+	}
+	TMatrixType aResult(mt1.Size, INIT_ZERO, mt1.Alloc);
+	if (mt1.Size < TRMM_SIMPLE_THRESHOLD)
+	{
+		TMatrixType::MultiplySimple(mt1.pMatrix, mt2.pMatrix, aResult.pMatrix, mt1.Size);
+	}
+	else
+	{
+		TMatrixType::MultiplyBlocked(mt1.pMatrix, mt2.pMatrix, aResult.pMatrix, mt1.Size);
+	}
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType, class VecAllocType> // A * x: y(i) - скалярное произведение хранимой части строки i
+TVector<ValType, VecAllocType> operator*(const TMatrix<ValType, AllocType> &mt, const TVector<ValType, VecAllocType> &v)
+{
+	const TIndex n = mt.Size;
+	if (n != v.GetSize())
+	{
+		throw std::runtime_error("Can't multiply matrix by vector with different size");
+	}
+	TVector<ValType, VecAllocType> aResult(n, 0, v.GetAllocator());
+	ValType *y = aResult.data();
+	for (TIndex i = 0; i < n; ++i)
+	{
+		y[i] = VecDot(mt.pMatrix + TMatrix<ValType, AllocType>::RowOffset(i, n), v.data() + i, n - i);
+	}
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType, class VecAllocType> // x * A: y += x(i) * строка i, проход по буферу подряд
+TVector<ValType, VecAllocType> operator*(const TVector<ValType, VecAllocType> &v, const TMatrix<ValType, AllocType> &mt)
+{
+	const TIndex n = mt.Size;
+	if (n != v.GetSize())
+	{
+		throw std::runtime_error("Can't multiply vector by matrix with different size");
+	}
+	TVector<ValType, VecAllocType> aResult(n, 0, v.GetAllocator());
+	ValType *y = aResult.data();
+	const ValType *x = v.data();
+	std::fill(y, y + n, ValType());
+	for (TIndex i = 0; i < n; ++i)
+	{
+		VecAxpy(y + i, x[i], mt.pMatrix + TMatrix<ValType, AllocType>::RowOffset(i, n), n - i);
+	}
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+// Обратная подстановка. Решение записывается на место правой части;
+// нулевой элемент диагонали обнаруживается до начала вычислений.
+
+template <class ValType, class AllocType> // проверка диагонали
+void CheckPivots(const TMatrix<ValType, AllocType> &mt)
+{
+	for (TIndex i = 0; i < mt.GetSize(); ++i)
+	{
+		if (mt.UncheckedAt(i, i) == ValType())
+		{
+			throw std::runtime_error("Can't solve system with zero pivot");
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class AllocType, class VecAllocType> // A x = b
+void Solve(const TMatrix<ValType, AllocType> &mt, TVector<ValType, VecAllocType> &b)
+{
+	const TIndex n = mt.Size;
+	if (n != b.GetSize())
+	{
+		throw std::runtime_error("Can't solve system with right-hand side of different size");
+	}
+	CheckPivots(mt);
+	ValType *x = b.data();
+	for (TIndex i = n - 1; i >= 0; --i)
+	{
+		const ValType *a = mt.pMatrix + TMatrix<ValType, AllocType>::RowOffset(i, n);
+		x[i] = (x[i] - VecDot(a + 1, x + i + 1, n - i - 1)) / a[0];
+	}
+} /*-------------------------------------------------------------------------*/
+
+// X(r, i) -= sum_k A(i, k) X(r, k) для строк i из [0, ie), столбцов k из
+// [jb, je) и всех правых частей X(r) = pX[r] - умножение блока матрицы на
+// панель решенных элементов, как в GEMM. Панель упаковывается построчно
+// (panel[k][r] = X(r, jb + k)) и остается в кэше, пока через нее проходят
+// все строки A; четыре строки результата накапливаются одним VecAxpy4, так
+// что каждая строка панели загружается один раз на четыре строки A
+template <class ValType>
+void SolveUpdate(const ValType *pA, TIndex n, TIndex ie, TIndex jb, TIndex je, ValType *const *pX, TIndex m)
+{
+	const TIndex len = je - jb;
+	std::vector<ValType> panel((size_t)(len * m)), rows((size_t)(4 * m));
+	for (TIndex r = 0; r < m; ++r)
+	{
+		for (TIndex k = 0; k < len; ++k)
+		{
+			panel[(size_t)(k * m + r)] = pX[r][jb + k];
+		}
+	}
+	ValType *aRow[4] = { rows.data(), rows.data() + m, rows.data() + 2 * m, rows.data() + 3 * m };
+	for (TIndex ib = 0; ib < ie; ib += 4)
+	{
+		// последняя четверка дополняется повтором строки ie - 1
+		const ValType *aA[4];
+		for (int q = 0; q < 4; ++q)
+		{
+			aA[q] = pA + PackedOffset(std::min<TIndex>(ib + q, ie - 1), jb, n);
+		}
+		std::fill(rows.begin(), rows.end(), ValType());
+		for (TIndex k = 0; k < len; ++k)
+		{
+			const ValType aAlpha[4] = { aA[0][k], aA[1][k], aA[2][k], aA[3][k] };
+			VecAxpy4(aRow, aAlpha, panel.data() + k * m, m);
+		}
+		for (TIndex i = ib; i < std::min<TIndex>(ib + 4, ie); ++i)
+		{
+			for (TIndex r = 0; r < m; ++r)
+			{
+				pX[r][i] -= aRow[i - ib][r];
+			}
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+// A X = B для набора правых частей rhs[0..m) - блочная обратная подстановка
+// уровня 3 (как TRSM): строки обрабатываются блоками J снизу вверх; блок
+// решается подстановкой для каждой правой части, затем его вклад вычитается
+// из всех строк выше одним умножением A(0:J, J) X(J) (SolveUpdate).
+template <class ValType, class AllocType, class VecAllocType, class OuterAllocType>
+void Solve(const TMatrix<ValType, AllocType> &mt, TVector<TVector<ValType, VecAllocType>, OuterAllocType> &rhs)
+{
+	typedef TMatrix<ValType, AllocType> TMatrixType;
+	const TIndex n = mt.Size, m = rhs.GetSize();
+	TVector<ValType, VecAllocType> *pRhs = rhs.data();
+	std::vector<ValType*> aX((size_t)m);
+	for (TIndex r = 0; r < m; ++r)
+	{
+		if (pRhs[r].GetSize() != n)
+		{
+			throw std::runtime_error("Can't solve system with right-hand side of different size");
+		}
+		aX[(size_t)r] = pRhs[r].data();
+	}
+	CheckPivots(mt);
+	for (TIndex je = n; je > 0; je -= TRSM_BLOCK_SIZE)
+	{
+		const TIndex jb = std::max<TIndex>(je - TRSM_BLOCK_SIZE, 0);
+		for (TIndex r = 0; r < m; ++r)
+		{
+			ValType *x = aX[(size_t)r];
+			for (TIndex i = je - 1; i >= jb; --i)
+			{
+				const ValType *a = mt.pMatrix + TMatrixType::RowOffset(i, n);
+				x[i] = (x[i] - VecDot(a + 1, (const ValType*)x + i + 1, je - i - 1)) / a[0];
+			}
+		}
+		SolveUpdate(mt.pMatrix, n, jb, jb, je, aX.data(), m);
+	}
+} /*-------------------------------------------------------------------------*/
+
+// Операнды-векторы и матрицы хранятся в узлах выражений по ссылке
+template <class ValType, class AllocType>
+struct TExprRef<TVector<ValType, AllocType> >
+{
+  typedef const TVector<ValType, AllocType> &type;
+};
+
+template <class ValType, class AllocType>
+struct TExprRef<TMatrix<ValType, AllocType> >
+{
+  typedef const TMatrix<ValType, AllocType> &type;
+};
+
+#include "utmatrix_fixed.h"
 
 // TVector О3 Л2 П4 С6
 // TMatrix О2 Л2 П3 С3
@@ -0,0 +1,416 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_alloc.h
+//
+// Распределители памяти для TVector и TMatrix (второй параметр шаблона).
+// Распределитель отвечает только за память: элементы создаются
+// конструктором по умолчанию, как при new ValType[n]. Необязательный метод
+// allocate_zeroed(n) возвращает обнуленную память; для арифметических типов
+// он заменяет отдельное обнуление элементов.
+//
+//   TAlignedAllocator - выровненные блоки из malloc/calloc или, для больших
+//                       блоков по запросу, из mmap с большими страницами;
+//   TArenaAllocator   - выделение сдвигом указателя в общей арене, память
+//                       возвращается сразу вся (TArena::Reset);
+//   TPoolAllocator    - списки свободных блоков по классам размеров для
+//                       множества мелких векторов и матриц.
+//
+// Арена и пул не потокобезопасны; распределители арены и пула хранят
+// только указатель на нее, арена и пул должны жить дольше объектов.
+
+#ifndef __TMATRIX_ALLOC_H__
+#define __TMATRIX_ALLOC_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define UTMATRIX_HAVE_MMAP 1
+#endif
+
+const size_t STORAGE_ALIGNMENT = 64;           // выравнивание буфера матрицы (строка кэша)
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // блоки меньше одной большой страницы берутся из malloc
+
+// Источник страниц для больших блоков TAlignedAllocator
+enum TPagePolicy
+{
+  PAGES_DEFAULT,         // malloc/calloc
+  PAGES_HUGE,            // mmap + madvise(MADV_HUGEPAGE): меньше промахов TLB
+  PAGES_HUGE_FIRST_TOUCH // то же; TMatrix заполняет страницы теми потоками пула,
+                         // которые затем обрабатывают соответствующие строки
+};
+
+// Наличие метода allocate_zeroed у распределителя
+template <class AllocType, class = void>
+struct THasAllocateZeroed : std::false_type {};
+
+template <class AllocType>
+struct THasAllocateZeroed<AllocType,
+  decltype((void)std::declval<AllocType&>().allocate_zeroed(size_t(1)))> : std::true_type {};
+
+// Наличие политики страниц (GetPagePolicy) у распределителя
+template <class AllocType, class = void>
+struct THasPagePolicy : std::false_type {};
+
+template <class AllocType>
+struct THasPagePolicy<AllocType,
+  decltype((void)std::declval<const AllocType&>().GetPagePolicy())> : std::true_type {};
+
+// Память под count элементов и их создание: конструктором по умолчанию
+// или, при zero, значением ValType()
+template <class AllocType>
+typename std::allocator_traits<AllocType>::value_type* AllocateElements(AllocType &alloc, size_t count, bool zero)
+{
+	typedef typename std::allocator_traits<AllocType>::value_type ValType;
+	if constexpr (THasAllocateZeroed<AllocType>::value && std::is_arithmetic<ValType>::value)
+	{
+		if (zero)
+		{
+			return alloc.allocate_zeroed(count);
+		}
+	}
+	ValType *p = std::allocator_traits<AllocType>::allocate(alloc, count);
+	try
+	{
+		if (zero)
+			std::uninitialized_value_construct_n(p, count);
+		else
+			std::uninitialized_default_construct_n(p, count);
+	}
+	catch (...)
+	{
+		std::allocator_traits<AllocType>::deallocate(alloc, p, count);
+		throw;
+	}
+	return p;
+} /*-------------------------------------------------------------------------*/
+
+template <class AllocType> // разрушение элементов и освобождение памяти
+void FreeElements(AllocType &alloc, typename std::allocator_traits<AllocType>::value_type *p, size_t count)
+{
+	if (p != nullptr)
+	{
+		std::destroy_n(p, count);
+		std::allocator_traits<AllocType>::deallocate(alloc, p, count);
+	}
+} /*-------------------------------------------------------------------------*/
+
+// Выровненный блок. Перед началом блока хранятся исходный указатель и
+// длина отображения mmap (0 - блок из malloc), поэтому освободить блок
+// можно независимо от того, как он был получен
+inline void* AlignedAlloc(size_t bytes, size_t alignment, bool zero, TPagePolicy policy = PAGES_DEFAULT)
+{
+	const size_t header = 2 * sizeof(void*);
+	const size_t offset = (header + alignment - 1) & ~(alignment - 1); // от начала области до данных
+	void *pRaw = nullptr;
+	uintptr_t start = 0;  // начало области, от которого отсчитывается offset
+	size_t mapped = 0;
+#ifdef UTMATRIX_HAVE_MMAP
+	if (policy != PAGES_DEFAULT && bytes >= HUGE_PAGE_SIZE)
+	{
+		// запас в одну большую страницу, чтобы область начиналась у ее границы;
+		// память mmap уже обнулена и выделяется при первом обращении
+		const size_t length = ((bytes + offset + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1)) + HUGE_PAGE_SIZE;
+		void *pMap = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pMap != MAP_FAILED)
+		{
+			const uintptr_t base = reinterpret_cast<uintptr_t>(pMap);
+			pRaw = pMap;
+			mapped = length;
+			start = (base + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+#ifdef MADV_HUGEPAGE
+			madvise(reinterpret_cast<void*>(start), (base + length - start) & ~(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE);
+#endif
+		}
+		// если mmap отказал, блок берется из malloc
+	}
+#endif
+	if (pRaw == nullptr)
+	{
+		const size_t total = bytes + offset + alignment;
+		pRaw = zero ? std::calloc(total, 1) : std::malloc(total);
+		if (pRaw == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		start = (reinterpret_cast<uintptr_t>(pRaw) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+	void *p = reinterpret_cast<void*>(start + offset);
+	static_cast<void**>(p)[-1] = pRaw;
+	static_cast<size_t*>(p)[-2] = mapped;
+	return p;
+}
+
+inline void AlignedFree(void *p)
+{
+	if (p == nullptr)
+	{
+		return;
+	}
+	void *pRaw = static_cast<void**>(p)[-1];
+	const size_t mapped = static_cast<size_t*>(p)[-2];
+#ifdef UTMATRIX_HAVE_MMAP
+	if (mapped != 0)
+	{
+		munmap(pRaw, mapped);
+		return;
+	}
+#endif
+	std::free(pRaw);
+}
+
+// Выровненный распределитель; calloc не заполняет заново страницы,
+// полученные от системы, поэтому большой обнуленный блок обходится дешево.
+// Политика страниц задается для каждого объекта; любой экземпляр
+// освобождает блоки любого другого
+template <class ValType, size_t Alignment = STORAGE_ALIGNMENT>
+class TAlignedAllocator
+{
+  static_assert((Alignment & (Alignment - 1)) == 0 && Alignment >= sizeof(void*),
+    "Alignment must be a power of two not less than pointer size");
+  TPagePolicy Policy;
+public:
+  typedef ValType value_type;
+  template <class OtherType>
+  struct rebind { typedef TAlignedAllocator<OtherType, Alignment> other; };
+
+  TAlignedAllocator(TPagePolicy policy = PAGES_DEFAULT) noexcept : Policy(policy) {}
+  template <class OtherType>
+  TAlignedAllocator(const TAlignedAllocator<OtherType, Alignment> &a) noexcept : Policy(a.GetPagePolicy()) {}
+  TPagePolicy GetPagePolicy() const { return Policy; }
+  ValType* allocate(size_t n) { return static_cast<ValType*>(AlignedAlloc(n * sizeof(ValType), Alignment, false, Policy)); }
+  ValType* allocate_zeroed(size_t n) { return static_cast<ValType*>(AlignedAlloc(n * sizeof(ValType), Alignment, true, Policy)); }
+  void deallocate(ValType *p, size_t) noexcept { AlignedFree(p); }
+  template <class OtherType>
+  bool operator==(const TAlignedAllocator<OtherType, Alignment>&) const noexcept { return true; }
+  template <class OtherType>
+  bool operator!=(const TAlignedAllocator<OtherType, Alignment>&) const noexcept { return false; }
+};
+
+
+// Арена: память берется из больших участков сдвигом указателя, отдельные
+// блоки не освобождаются. Подходит для короткоживущих временных объектов
+class TArena
+{
+  std::vector<void*> Chunks; // участки памяти
+  char *pCurrent;            // свободная часть текущего участка
+  char *pEnd;
+  size_t ChunkSize;          // размер обычного участка
+  size_t Used;               // выдано байт с последнего Reset
+public:
+  explicit TArena(size_t chunkSize = 1 << 20)
+    : pCurrent(nullptr), pEnd(nullptr), ChunkSize(chunkSize), Used(0) {}
+  TArena(const TArena&) = delete;
+  TArena& operator=(const TArena&) = delete;
+  ~TArena() { Release(); }
+
+  void* Allocate(size_t bytes, size_t alignment);
+  void Reset();                              // вернуть всю выданную память
+  size_t GetUsed() const { return Used; }
+private:
+  void Release();
+};
+
+inline void* TArena::Allocate(size_t bytes, size_t alignment)
+{
+	uintptr_t aligned = (reinterpret_cast<uintptr_t>(pCurrent) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (pCurrent == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(pEnd))
+	{
+		const size_t size = std::max(ChunkSize, bytes + alignment);
+		void *pChunk = std::malloc(size);
+		if (pChunk == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		Chunks.push_back(pChunk);
+		pCurrent = static_cast<char*>(pChunk);
+		pEnd = pCurrent + size;
+		aligned = (reinterpret_cast<uintptr_t>(pCurrent) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+	pCurrent = reinterpret_cast<char*>(aligned + bytes);
+	Used += bytes;
+	return reinterpret_cast<void*>(aligned);
+} /*-------------------------------------------------------------------------*/
+
+inline void TArena::Reset()
+{
+	// первый участок остается для следующих выделений
+	if (Chunks.size() > 1)
+	{
+		for (size_t c = 1; c < Chunks.size(); ++c)
+		{
+			std::free(Chunks[c]);
+		}
+		Chunks.resize(1);
+	}
+	if (!Chunks.empty())
+	{
+		pCurrent = static_cast<char*>(Chunks[0]);
+		pEnd = pCurrent + ChunkSize;
+	}
+	Used = 0;
+} /*-------------------------------------------------------------------------*/
+
+inline void TArena::Release()
+{
+	for (size_t c = 0; c < Chunks.size(); ++c)
+	{
+		std::free(Chunks[c]);
+	}
+	Chunks.clear();
+	pCurrent = pEnd = nullptr;
+	Used = 0;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+class TArenaAllocator
+{
+  template <class OtherType> friend class TArenaAllocator;
+  TArena *pArena;
+public:
+  typedef ValType value_type;
+  template <class OtherType>
+  struct rebind { typedef TArenaAllocator<OtherType> other; };
+
+  TArenaAllocator(TArena &arena) noexcept : pArena(&arena) {}
+  template <class OtherType>
+  TArenaAllocator(const TArenaAllocator<OtherType> &a) noexcept : pArena(a.pArena) {}
+  TArena& GetArena() const { return *pArena; }
+  ValType* allocate(size_t n)
+  {
+	  const size_t alignment = alignof(ValType) < alignof(std::max_align_t) ? alignof(std::max_align_t) : alignof(ValType);
+	  return static_cast<ValType*>(pArena->Allocate(n * sizeof(ValType), alignment));
+  }
+  void deallocate(ValType*, size_t) noexcept {} // память возвращается в TArena::Reset
+  template <class OtherType>
+  bool operator==(const TArenaAllocator<OtherType> &a) const noexcept { return pArena == a.pArena; }
+  template <class OtherType>
+  bool operator!=(const TArenaAllocator<OtherType> &a) const noexcept { return pArena != a.pArena; }
+};
+
+
+// Пул: блоки размеров 16, 32, ..., 4096 байт нарезаются из участков по
+// 64 Кбайт и после освобождения попадают в список своего класса. Участок
+// выровнен по MAX_BLOCK, поэтому блок выровнен по своему размеру, и для
+// выравнивания alignment берется блок не меньше alignment. Более крупные
+// блоки берутся из AlignedAlloc
+class TPool
+{
+public:
+  static constexpr size_t MIN_BLOCK = 16;
+  static constexpr int CLASS_COUNT = 9;          // 16 << 8 = 4096
+  static constexpr size_t MAX_BLOCK = MIN_BLOCK << (CLASS_COUNT - 1);
+  static constexpr size_t SLAB_SIZE = 64 * 1024;
+private:
+  struct TFreeBlock { TFreeBlock *pNext; };
+  TFreeBlock *aFree[CLASS_COUNT];            // свободные блоки по классам
+  std::vector<void*> Slabs;
+
+  static int SizeClass(size_t bytes)         // -1 - блок не из пула
+  {
+	  size_t block = MIN_BLOCK;
+	  for (int c = 0; c < CLASS_COUNT; ++c, block <<= 1)
+	  {
+		  if (bytes <= block)
+		  {
+			  return c;
+		  }
+	  }
+	  return -1;
+  }
+  void Refill(int c);
+public:
+  TPool() { std::fill(aFree, aFree + CLASS_COUNT, nullptr); }
+  TPool(const TPool&) = delete;
+  TPool& operator=(const TPool&) = delete;
+  ~TPool()
+  {
+	  for (size_t s = 0; s < Slabs.size(); ++s)
+	  {
+		  AlignedFree(Slabs[s]);
+	  }
+  }
+  void* Allocate(size_t bytes, size_t alignment = MIN_BLOCK);
+  void Deallocate(void *p, size_t bytes, size_t alignment = MIN_BLOCK) noexcept;
+};
+
+inline void TPool::Refill(int c)
+{
+	const size_t block = MIN_BLOCK << c;
+	char *pSlab = static_cast<char*>(AlignedAlloc(SLAB_SIZE, MAX_BLOCK, false));
+	try
+	{
+		Slabs.push_back(pSlab);
+	}
+	catch (...)
+	{
+		AlignedFree(pSlab);
+		throw;
+	}
+	for (size_t offset = 0; offset + block <= SLAB_SIZE; offset += block)
+	{
+		TFreeBlock *p = reinterpret_cast<TFreeBlock*>(pSlab + offset);
+		p->pNext = aFree[c];
+		aFree[c] = p;
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void* TPool::Allocate(size_t bytes, size_t alignment)
+{
+	const int c = SizeClass(std::max(bytes, alignment));
+	if (c < 0)
+	{
+		return AlignedAlloc(bytes, std::max(alignment, MIN_BLOCK), false);
+	}
+	if (aFree[c] == nullptr)
+	{
+		Refill(c);
+	}
+	TFreeBlock *p = aFree[c];
+	aFree[c] = p->pNext;
+	return p;
+} /*-------------------------------------------------------------------------*/
+
+inline void TPool::Deallocate(void *p, size_t bytes, size_t alignment) noexcept
+{
+	const int c = SizeClass(std::max(bytes, alignment));
+	if (c < 0)
+	{
+		AlignedFree(p);
+		return;
+	}
+	TFreeBlock *pBlock = static_cast<TFreeBlock*>(p);
+	pBlock->pNext = aFree[c];
+	aFree[c] = pBlock;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+class TPoolAllocator
+{
+  template <class OtherType> friend class TPoolAllocator;
+  TPool *pPool;
+public:
+  typedef ValType value_type;
+  template <class OtherType>
+  struct rebind { typedef TPoolAllocator<OtherType> other; };
+
+  TPoolAllocator(TPool &pool) noexcept : pPool(&pool) {}
+  template <class OtherType>
+  TPoolAllocator(const TPoolAllocator<OtherType> &a) noexcept : pPool(a.pPool) {}
+  TPool& GetPool() const { return *pPool; }
+  ValType* allocate(size_t n) { return static_cast<ValType*>(pPool->Allocate(n * sizeof(ValType), alignof(ValType))); }
+  void deallocate(ValType *p, size_t n) noexcept { pPool->Deallocate(p, n * sizeof(ValType), alignof(ValType)); }
+  template <class OtherType>
+  bool operator==(const TPoolAllocator<OtherType> &a) const noexcept { return pPool == a.pPool; }
+  template <class OtherType>
+  bool operator!=(const TPoolAllocator<OtherType> &a) const noexcept { return pPool != a.pPool; }
+};
+
+#endif
@@ -0,0 +1,224 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_binary.h
+//
+// Двоичный формат векторов и матриц: заголовок TBinaryHeader (64 байта)
+// и следом хранимые элементы одним блоком - для матрицы упакованные строки
+// верхнего треугольника, как в буфере TMatrix. Запись и чтение выполняются
+// одной операцией без разбора элементов; файл матрицы можно отобразить в
+// память (TMatrix::MapBinary), данные после заголовка остаются выровненными.
+//
+// Элементы хранятся в порядке байтов записавшей машины; файл с другим
+// порядком байтов, версией или типом элементов не читается.
+
+#ifndef __TMATRIX_BINARY_H__
+#define __TMATRIX_BINARY_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+const char BINARY_MAGIC[8] = { 'U', 'T', 'M', 'A', 'T', 'R', 'I', 'X' };
+const uint32_t BINARY_VERSION = 1;
+const uint32_t BINARY_BYTE_ORDER = 0x01020304; // читается иначе при другом порядке байтов
+
+// Расположение элементов
+enum TBinaryLayout
+{
+  LAYOUT_VECTOR = 1,       // Size элементов вектора
+  LAYOUT_UPPER_PACKED = 2  // Size (Size + 1) / 2 элементов: строки i..Size-1 подряд
+};
+
+// Вид элементов; вместе с размером элемента определяет тип
+enum TBinaryType
+{
+  TYPE_OTHER = 0,    // прочие тривиально копируемые типы - сверяется только размер
+  TYPE_SIGNED = 1,
+  TYPE_UNSIGNED = 2,
+  TYPE_FLOAT = 3,
+  TYPE_BOOL = 4
+};
+
+template <class ValType>
+constexpr uint32_t BinaryTypeOf()
+{
+	return std::is_same<ValType, bool>::value ? TYPE_BOOL :
+		std::is_floating_point<ValType>::value ? TYPE_FLOAT :
+		std::is_integral<ValType>::value && std::is_signed<ValType>::value ? TYPE_SIGNED :
+		std::is_integral<ValType>::value ? TYPE_UNSIGNED : TYPE_OTHER;
+}
+
+struct TBinaryHeader
+{
+  char Magic[8];         // BINARY_MAGIC
+  uint32_t Version;      // BINARY_VERSION
+  uint32_t ByteOrder;    // BINARY_BYTE_ORDER в порядке байтов записавшей машины
+  uint32_t Layout;       // TBinaryLayout
+  uint32_t Type;         // TBinaryType
+  uint32_t ElementSize;  // sizeof(ValType)
+  uint32_t HeaderSize;   // смещение данных от начала
+  int64_t Size;          // длина вектора или порядок матрицы
+  int64_t StartIndex;    // индекс первого элемента вектора
+  uint64_t DataSize;     // длина данных в байтах
+  uint64_t Checksum;     // BinaryChecksum данных
+};
+
+static_assert(sizeof(TBinaryHeader) == 64, "Binary header must keep data aligned");
+
+// Контрольная сумма Флетчера по 64-битным словам (хвост дополняется
+// нулями); данные можно добавлять частями любой длины
+class TBinaryChecksum
+{
+  uint64_t A, B;
+  char Tail[sizeof(uint64_t)]; // начало неполного слова
+  size_t TailSize;
+  void AddWord(uint64_t word) { A += word; B += A; }
+public:
+  TBinaryChecksum() : A(0), B(0), TailSize(0) {}
+  void Add(const void *p, size_t bytes);
+  uint64_t Get() const;
+};
+
+inline void TBinaryChecksum::Add(const void *p, size_t bytes)
+{
+	const char *pBytes = static_cast<const char*>(p);
+	uint64_t word;
+	if (TailSize > 0)
+	{
+		const size_t k = std::min(bytes, sizeof(word) - TailSize);
+		std::memcpy(Tail + TailSize, pBytes, k);
+		TailSize += k;
+		pBytes += k;
+		bytes -= k;
+		if (TailSize < sizeof(word))
+		{
+			return;
+		}
+		std::memcpy(&word, Tail, sizeof(word));
+		AddWord(word);
+		TailSize = 0;
+	}
+	for (; bytes >= sizeof(word); pBytes += sizeof(word), bytes -= sizeof(word))
+	{
+		std::memcpy(&word, pBytes, sizeof(word));
+		AddWord(word);
+	}
+	std::memcpy(Tail, pBytes, bytes);
+	TailSize = bytes;
+} /*-------------------------------------------------------------------------*/
+
+inline uint64_t TBinaryChecksum::Get() const
+{
+	uint64_t a = A, b = B;
+	if (TailSize > 0)
+	{
+		uint64_t word = 0;
+		std::memcpy(&word, Tail, TailSize);
+		a += word;
+		b += a;
+	}
+	return b ^ (a << 32 | a >> 32);
+} /*-------------------------------------------------------------------------*/
+
+inline uint64_t BinaryChecksum(const void *p, size_t bytes)
+{
+	TBinaryChecksum checksum;
+	checksum.Add(p, bytes);
+	return checksum.Get();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // заголовок для count элементов с контрольной суммой checksum
+TBinaryHeader MakeBinaryHeader(TBinaryLayout layout, int64_t size, int64_t startIndex,
+	uint64_t count, uint64_t checksum)
+{
+	static_assert(std::is_trivially_copyable<ValType>::value, "Only trivially copyable elements can be stored");
+	TBinaryHeader h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.Magic, BINARY_MAGIC, sizeof(h.Magic));
+	h.Version = BINARY_VERSION;
+	h.ByteOrder = BINARY_BYTE_ORDER;
+	h.Layout = layout;
+	h.Type = BinaryTypeOf<ValType>();
+	h.ElementSize = sizeof(ValType);
+	h.HeaderSize = sizeof(TBinaryHeader);
+	h.Size = size;
+	h.StartIndex = startIndex;
+	h.DataSize = count * sizeof(ValType);
+	h.Checksum = checksum;
+	return h;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // заголовок для count элементов из p
+TBinaryHeader MakeBinaryHeader(TBinaryLayout layout, int64_t size, int64_t startIndex,
+	const ValType *p, size_t count)
+{
+	return MakeBinaryHeader<ValType>(layout, size, startIndex, (uint64_t)count,
+		BinaryChecksum(p, count * sizeof(ValType)));
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // проверка заголовка перед чтением данных
+void CheckBinaryHeader(const TBinaryHeader &h, TBinaryLayout layout)
+{
+	static_assert(std::is_trivially_copyable<ValType>::value, "Only trivially copyable elements can be loaded");
+	if (std::memcmp(h.Magic, BINARY_MAGIC, sizeof(h.Magic)) != 0)
+	{
+		throw std::runtime_error("Can't load data: not a matrix file");
+	}
+	if (h.ByteOrder != BINARY_BYTE_ORDER)
+	{
+		throw std::runtime_error("Can't load data with other byte order");
+	}
+	if (h.Version != BINARY_VERSION || h.HeaderSize != sizeof(TBinaryHeader))
+	{
+		throw std::runtime_error("Can't load data of unsupported version");
+	}
+	if (h.Layout != (uint32_t)layout)
+	{
+		throw std::runtime_error("Can't load data with other layout");
+	}
+	if (h.Type != BinaryTypeOf<ValType>() || h.ElementSize != sizeof(ValType))
+	{
+		throw std::runtime_error("Can't load data with other element type");
+	}
+} /*-------------------------------------------------------------------------*/
+
+// Запись заголовка и данных
+inline void WriteBinary(std::ostream &out, const TBinaryHeader &h, const void *p)
+{
+	out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+	out.write(static_cast<const char*>(p), (std::streamsize)h.DataSize);
+	if (!out)
+	{
+		throw std::runtime_error("Can't write binary data");
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline TBinaryHeader ReadBinaryHeader(std::istream &in)
+{
+	TBinaryHeader h;
+	if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)))
+	{
+		throw std::runtime_error("Can't read binary header");
+	}
+	return h;
+} /*-------------------------------------------------------------------------*/
+
+// Чтение данных прямо в буфер p и сверка контрольной суммы
+inline void ReadBinaryData(std::istream &in, const TBinaryHeader &h, void *p)
+{
+	if (!in.read(static_cast<char*>(p), (std::streamsize)h.DataSize))
+	{
+		throw std::runtime_error("Can't read binary data");
+	}
+	if (BinaryChecksum(p, h.DataSize) != h.Checksum)
+	{
+		throw std::runtime_error("Can't load data with wrong checksum");
+	}
+} /*-------------------------------------------------------------------------*/
+
+#endif
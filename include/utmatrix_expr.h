@@ -0,0 +1,204 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_expr.h
+//
+// Отложенные поэлементные выражения над векторами и матрицами. Операции
+// +, - и умножение на скаляр возвращают узлы выражения, которые вычисляются
+// одним проходом при присваивании в TVector или TMatrix, без промежуточных
+// объектов. Скалярное произведение вычисляется сразу.
+
+#ifndef __TMATRIX_EXPR_H__
+#define __TMATRIX_EXPR_H__
+
+#include <stdexcept>
+#include "utmatrix_index.h"
+
+// Способ хранения операнда внутри узла: узлы хранятся по значению,
+// векторы и матрицы (уточняется в utmatrix.h) - по ссылке
+template <class ExprType>
+struct TExprRef
+{
+  typedef const ExprType type;
+};
+
+// Поэлементные операции
+struct TAddOp
+{
+  template <class T> static T Apply(const T &a, const T &b) { return a + b; }
+};
+
+struct TSubOp
+{
+  template <class T> static T Apply(const T &a, const T &b) { return a - b; }
+};
+
+struct TMulOp
+{
+  template <class T> static T Apply(const T &a, const T &b) { return a * b; }
+};
+
+// Векторное выражение: размер, индекс первого элемента и значение
+// k-го хранимого элемента Eval(k), 0 <= k < GetSize()
+template <class ExprType>
+class TVectorExpr
+{
+public:
+  const ExprType& Self() const { return static_cast<const ExprType&>(*this); }
+};
+
+template <class LeftType, class RightType, class OpType>
+class TVectorBinary : public TVectorExpr<TVectorBinary<LeftType, RightType, OpType> >
+{
+  typename TExprRef<LeftType>::type Left;
+  typename TExprRef<RightType>::type Right;
+public:
+  typedef typename LeftType::ValueType ValueType;
+
+  TVectorBinary(const LeftType &l, const RightType &r) : Left(l), Right(r) {}
+  const LeftType& GetLeft() const { return Left; }
+  const RightType& GetRight() const { return Right; }
+  TIndex GetSize() const { return Left.GetSize(); }
+  TIndex GetStartIndex() const { return Left.GetStartIndex(); }
+  ValueType Eval(TIndex k) const { return OpType::template Apply<ValueType>(Left.Eval(k), Right.Eval(k)); }
+};
+
+template <class ExprType, class OpType>
+class TVectorScalar : public TVectorExpr<TVectorScalar<ExprType, OpType> >
+{
+public:
+  typedef typename ExprType::ValueType ValueType;
+private:
+  typename TExprRef<ExprType>::type Expr;
+  ValueType Value;
+public:
+  TVectorScalar(const ExprType &e, const ValueType &val) : Expr(e), Value(val) {}
+  const ExprType& GetExpr() const { return Expr; }
+  const ValueType& GetValue() const { return Value; }
+  TIndex GetSize() const { return Expr.GetSize(); }
+  TIndex GetStartIndex() const { return Expr.GetStartIndex(); }
+  ValueType Eval(TIndex k) const { return OpType::template Apply<ValueType>(Expr.Eval(k), Value); }
+};
+
+template <class LeftType, class RightType> // сложение
+TVectorBinary<LeftType, RightType, TAddOp> operator+(const TVectorExpr<LeftType> &l, const TVectorExpr<RightType> &r)
+{
+	if (l.Self().GetSize() != r.Self().GetSize())
+	{
+		throw std::runtime_error("Can't add vector with different size");
+	}
+	return TVectorBinary<LeftType, RightType, TAddOp>(l.Self(), r.Self());
+} /*-------------------------------------------------------------------------*/
+
+template <class LeftType, class RightType> // вычитание
+TVectorBinary<LeftType, RightType, TSubOp> operator-(const TVectorExpr<LeftType> &l, const TVectorExpr<RightType> &r)
+{
+	if (l.Self().GetSize() != r.Self().GetSize())
+	{
+		throw std::runtime_error("Can't substract vector with different size");
+	}
+	return TVectorBinary<LeftType, RightType, TSubOp>(l.Self(), r.Self());
+} /*-------------------------------------------------------------------------*/
+
+template <class LeftType, class RightType> // скалярное произведение (вычисляется сразу)
+typename LeftType::ValueType operator*(const TVectorExpr<LeftType> &l, const TVectorExpr<RightType> &r)
+{
+	const LeftType &left = l.Self();
+	const RightType &right = r.Self();
+	if (left.GetSize() != right.GetSize())
+	{
+		throw std::runtime_error("Can't find dot product for vector with different size");
+	}
+	typename LeftType::ValueType aResult = 0;
+	for (TIndex k = 0; k < left.GetSize(); ++k)
+	{
+		aResult += left.Eval(k) * right.Eval(k);
+	}
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+template <class ExprType> // прибавить скаляр
+TVectorScalar<ExprType, TAddOp> operator+(const TVectorExpr<ExprType> &e, const typename ExprType::ValueType &val)
+{
+	return TVectorScalar<ExprType, TAddOp>(e.Self(), val);
+} /*-------------------------------------------------------------------------*/
+
+template <class ExprType> // вычесть скаляр
+TVectorScalar<ExprType, TSubOp> operator-(const TVectorExpr<ExprType> &e, const typename ExprType::ValueType &val)
+{
+	return TVectorScalar<ExprType, TSubOp>(e.Self(), val);
+} /*-------------------------------------------------------------------------*/
+
+template <class ExprType> // умножить на скаляр
+TVectorScalar<ExprType, TMulOp> operator*(const TVectorExpr<ExprType> &e, const typename ExprType::ValueType &val)
+{
+	return TVectorScalar<ExprType, TMulOp>(e.Self(), val);
+} /*-------------------------------------------------------------------------*/
+
+
+// Матричное выражение: порядок матрицы и значение k-го элемента общего
+// буфера Eval(k), 0 <= k < n(n+1)/2; у всех операндов одна упаковка
+template <class ExprType>
+class TMatrixExpr
+{
+public:
+  const ExprType& Self() const { return static_cast<const ExprType&>(*this); }
+};
+
+template <class LeftType, class RightType, class OpType>
+class TMatrixBinary : public TMatrixExpr<TMatrixBinary<LeftType, RightType, OpType> >
+{
+  typename TExprRef<LeftType>::type Left;
+  typename TExprRef<RightType>::type Right;
+public:
+  typedef typename LeftType::ValueType ValueType;
+
+  TMatrixBinary(const LeftType &l, const RightType &r) : Left(l), Right(r) {}
+  const LeftType& GetLeft() const { return Left; }
+  const RightType& GetRight() const { return Right; }
+  TIndex GetSize() const { return Left.GetSize(); }
+  ValueType Eval(TIndex k) const { return OpType::template Apply<ValueType>(Left.Eval(k), Right.Eval(k)); }
+};
+
+template <class ExprType, class OpType>
+class TMatrixScalar : public TMatrixExpr<TMatrixScalar<ExprType, OpType> >
+{
+public:
+  typedef typename ExprType::ValueType ValueType;
+private:
+  typename TExprRef<ExprType>::type Expr;
+  ValueType Value;
+public:
+  TMatrixScalar(const ExprType &e, const ValueType &val) : Expr(e), Value(val) {}
+  const ExprType& GetExpr() const { return Expr; }
+  const ValueType& GetValue() const { return Value; }
+  TIndex GetSize() const { return Expr.GetSize(); }
+  ValueType Eval(TIndex k) const { return OpType::template Apply<ValueType>(Expr.Eval(k), Value); }
+};
+
+template <class LeftType, class RightType> // сложение
+TMatrixBinary<LeftType, RightType, TAddOp> operator+(const TMatrixExpr<LeftType> &l, const TMatrixExpr<RightType> &r)
+{
+	if (l.Self().GetSize() != r.Self().GetSize())
+	{
+		throw std::runtime_error("Can't add matrix with different size");
+	}
+	return TMatrixBinary<LeftType, RightType, TAddOp>(l.Self(), r.Self());
+} /*-------------------------------------------------------------------------*/
+
+template <class LeftType, class RightType> // вычитание
+TMatrixBinary<LeftType, RightType, TSubOp> operator-(const TMatrixExpr<LeftType> &l, const TMatrixExpr<RightType> &r)
+{
+	if (l.Self().GetSize() != r.Self().GetSize())
+	{
+		throw std::runtime_error("Can't substract matrix with different size");
+	}
+	return TMatrixBinary<LeftType, RightType, TSubOp>(l.Self(), r.Self());
+} /*-------------------------------------------------------------------------*/
+
+template <class ExprType> // умножить на скаляр
+TMatrixScalar<ExprType, TMulOp> operator*(const TMatrixExpr<ExprType> &e, const typename ExprType::ValueType &val)
+{
+	return TMatrixScalar<ExprType, TMulOp>(e.Self(), val);
+} /*-------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,292 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_fixed.h
+//
+// Верхнетреугольная матрица порядка N, известного при компиляции. Для
+// малых матриц (преобразования 3x3 ... 16x16) выделение памяти и обращение
+// через указатель у TMatrix обходятся дороже самих вычислений, поэтому
+// здесь N(N+1)/2 элементов хранятся внутри объекта, смещения элементов
+// вычисляются при компиляции, а циклы сложения, умножения и обратной
+// подстановки полностью развернуты. Интерфейс совпадает с TMatrix в той
+// части, которая не зависит от динамического порядка, так что обобщенный
+// код работает с обоими классами. Подключается из utmatrix.h.
+
+#ifndef __TMATRIX_FIXED_H__
+#define __TMATRIX_FIXED_H__
+
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
+
+const TIndex MAX_FIXED_MATRIX_SIZE = 32; // больший порядок - TMatrix
+
+// f(0), ..., f(Count - 1); индекс передается как std::integral_constant,
+// то есть остается константой времени компиляции внутри f
+template <class FuncType, TIndex... K>
+inline void UnrollSequence(FuncType &f, std::integer_sequence<TIndex, K...>)
+{
+	(f(std::integral_constant<TIndex, K>()), ...);
+}
+
+template <TIndex Count, class FuncType>
+inline void Unroll(FuncType f)
+{
+	UnrollSequence(f, std::make_integer_sequence<TIndex, Count>());
+}
+
+template <class ValType, TIndex N>
+class TFixedMatrix
+{
+  static_assert(N > 0 && N <= MAX_FIXED_MATRIX_SIZE, "Invalid size for fixed matrix");
+
+  ValType Elements[PackedCount(N)]; // строки подряд, как в буфере TMatrix
+public:
+  typedef ValType ValueType;
+  static constexpr TIndex Offset(TIndex i, TIndex j) { return PackedOffset(i, j, N); } // смещение (i, j)
+
+  // TFixedMatrix m; - без инициализации, TFixedMatrix m = {}; - нули
+  TFixedMatrix() = default;
+  // s - для совместимости с TMatrix, должен быть равен N
+  explicit TFixedMatrix(TIndex s, TMatrixInit init = INIT_UNINITIALIZED);
+  template <class AllocType>
+  explicit TFixedMatrix(const TMatrix<ValType, AllocType> &mt); // копия матрицы порядка N
+  TMatrix<ValType> ToMatrix() const;                            // копия в динамической матрице
+
+  static constexpr TIndex GetSize() { return N; } // порядок матрицы
+  TMatrixRow<ValType> operator[](TIndex pos);     // доступ к строке
+  TMatrixRow<const ValType> operator[](TIndex pos) const;
+  ValType& UncheckedAt(TIndex i, TIndex j) { return Elements[Offset(i, j)]; } // элемент (i, j) без проверки
+  const ValType& UncheckedAt(TIndex i, TIndex j) const { return Elements[Offset(i, j)]; }
+  ValType* data() { return Elements; }            // N(N+1)/2 хранимых элементов
+  const ValType* data() const { return Elements; }
+  TTriangleView<ValType> View() { return TTriangleView<ValType>(Elements, N, 0, N); }
+  TTriangleView<const ValType> View() const { return TTriangleView<const ValType>(Elements, N, 0, N); }
+  bool operator==(const TFixedMatrix &mt) const;  // сравнение
+  bool operator!=(const TFixedMatrix &mt) const { return !(*this == mt); }
+
+  TFixedMatrix& operator+=(const TFixedMatrix &mt); // прибавить матрицу
+  TFixedMatrix& operator-=(const TFixedMatrix &mt); // вычесть матрицу
+  TFixedMatrix& operator*=(const ValType &val);     // умножить на скаляр
+  TFixedMatrix& operator/=(const ValType &val);     // разделить на скаляр
+  TFixedMatrix& Axpy(const ValType &alpha, const TFixedMatrix &mt); // this += alpha * mt
+
+  // результат - новая матрица в автоматической памяти, без выражений
+  TFixedMatrix operator+(const TFixedMatrix &mt) const { return TFixedMatrix(*this) += mt; }
+  TFixedMatrix operator-(const TFixedMatrix &mt) const { return TFixedMatrix(*this) -= mt; }
+  TFixedMatrix operator*(const ValType &val) const { return TFixedMatrix(*this) *= val; }
+  TFixedMatrix operator*(const TFixedMatrix &mt) const; // умножение
+
+  // ввод / вывод
+  friend istream& operator>>(istream &in, TFixedMatrix &mt)
+  {
+	  for (TIndex i = 0; i < N; i++)
+		  in >> mt[i];
+	  return in;
+  }
+  friend ostream & operator<<(ostream &out, const TFixedMatrix &mt)
+  {
+	  for (TIndex i = 0; i < N; i++)
+		  out << mt[i] << '\n';
+	  return out;
+  }
+};
+
+template <class ValType, TIndex N> // конструктор
+TFixedMatrix<ValType, N>::TFixedMatrix(TIndex s, TMatrixInit init)
+{
+	if (s != N)
+	{
+		throw std::runtime_error("Invalid size for fixed matrix");
+	}
+	if (init == INIT_ZERO)
+	{
+		Unroll<PackedCount(N)>([&](auto k) { Elements[k] = ValType(); });
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // копия матрицы порядка N
+template <class AllocType>
+TFixedMatrix<ValType, N>::TFixedMatrix(const TMatrix<ValType, AllocType> &mt)
+{
+	if (mt.GetSize() != N)
+	{
+		throw std::runtime_error("Can't convert matrix with different size");
+	}
+	View().CopyFrom(mt.View());
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // копия в динамической матрице
+TMatrix<ValType> TFixedMatrix<ValType, N>::ToMatrix() const
+{
+	TMatrix<ValType> aResult(N);
+	aResult.View().CopyFrom(View());
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // доступ к строке
+TMatrixRow<ValType> TFixedMatrix<ValType, N>::operator[](TIndex pos)
+{
+	if (CHECK_BOUNDS && (pos < 0 || pos >= N))
+	{
+		throw std::runtime_error("Invalid index in operator[]");
+	}
+	return TMatrixRow<ValType>(Elements + PackedRowOffset(pos, N), N - pos, pos);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // доступ к строке
+TMatrixRow<const ValType> TFixedMatrix<ValType, N>::operator[](TIndex pos) const
+{
+	if (CHECK_BOUNDS && (pos < 0 || pos >= N))
+	{
+		throw std::runtime_error("Invalid index in operator[]");
+	}
+	return TMatrixRow<const ValType>(Elements + PackedRowOffset(pos, N), N - pos, pos);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // сравнение
+bool TFixedMatrix<ValType, N>::operator==(const TFixedMatrix &mt) const
+{
+	for (TIndex k = 0; k < PackedCount(N); ++k)
+	{
+		if (Elements[k] != mt.Elements[k])
+		{
+			return false;
+		}
+	}
+	return true;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // прибавить матрицу
+TFixedMatrix<ValType, N>& TFixedMatrix<ValType, N>::operator+=(const TFixedMatrix &mt)
+{
+	Unroll<PackedCount(N)>([&](auto k) { Elements[k] += mt.Elements[k]; });
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // вычесть матрицу
+TFixedMatrix<ValType, N>& TFixedMatrix<ValType, N>::operator-=(const TFixedMatrix &mt)
+{
+	Unroll<PackedCount(N)>([&](auto k) { Elements[k] -= mt.Elements[k]; });
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // умножить на скаляр
+TFixedMatrix<ValType, N>& TFixedMatrix<ValType, N>::operator*=(const ValType &val)
+{
+	Unroll<PackedCount(N)>([&](auto k) { Elements[k] *= val; });
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // разделить на скаляр
+TFixedMatrix<ValType, N>& TFixedMatrix<ValType, N>::operator/=(const ValType &val)
+{
+	Unroll<PackedCount(N)>([&](auto k) { Elements[k] /= val; });
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // Y += alpha * X
+TFixedMatrix<ValType, N>& TFixedMatrix<ValType, N>::Axpy(const ValType &alpha, const TFixedMatrix &mt)
+{
+	Unroll<PackedCount(N)>([&](auto k) { Elements[k] += alpha * mt.Elements[k]; });
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N> // C(i, j) = сумма A(i, k) B(k, j), i <= k <= j
+TFixedMatrix<ValType, N> TFixedMatrix<ValType, N>::operator*(const TFixedMatrix &mt) const
+{
+	TFixedMatrix aResult(N, INIT_ZERO);
+	Unroll<N>([&](auto i)
+	{
+		constexpr TIndex I = decltype(i)::value;
+		Unroll<N - I>([&](auto dk)
+		{
+			constexpr TIndex K = I + decltype(dk)::value;
+			const ValType a = Elements[Offset(I, K)];
+			Unroll<N - K>([&](auto dj)
+			{
+				constexpr TIndex J = K + decltype(dj)::value;
+				aResult.Elements[Offset(I, J)] += a * mt.Elements[Offset(K, J)];
+			});
+		});
+	});
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N, class VecAllocType> // A * x
+TVector<ValType, VecAllocType> operator*(const TFixedMatrix<ValType, N> &mt, const TVector<ValType, VecAllocType> &v)
+{
+	if (v.GetSize() != N)
+	{
+		throw std::runtime_error("Can't multiply matrix by vector with different size");
+	}
+	TVector<ValType, VecAllocType> aResult(N, 0, v.GetAllocator());
+	ValType *y = aResult.data();
+	const ValType *x = v.data(), *a = mt.data();
+	Unroll<N>([&](auto i)
+	{
+		constexpr TIndex I = decltype(i)::value;
+		ValType s = ValType();
+		Unroll<N - I>([&](auto dj)
+		{
+			constexpr TIndex J = I + decltype(dj)::value;
+			s += a[PackedOffset(I, J, N)] * x[J];
+		});
+		y[I] = s;
+	});
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N, class VecAllocType> // x * A
+TVector<ValType, VecAllocType> operator*(const TVector<ValType, VecAllocType> &v, const TFixedMatrix<ValType, N> &mt)
+{
+	if (v.GetSize() != N)
+	{
+		throw std::runtime_error("Can't multiply vector by matrix with different size");
+	}
+	TVector<ValType, VecAllocType> aResult(N, 0, v.GetAllocator());
+	ValType *y = aResult.data();
+	const ValType *x = v.data(), *a = mt.data();
+	Unroll<N>([&](auto j)
+	{
+		constexpr TIndex J = decltype(j)::value;
+		ValType s = ValType();
+		Unroll<J + 1>([&](auto i)
+		{
+			constexpr TIndex I = decltype(i)::value;
+			s += x[I] * a[PackedOffset(I, J, N)];
+		});
+		y[J] = s;
+	});
+	return aResult;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, TIndex N, class VecAllocType> // A x = b, решение на месте b
+void Solve(const TFixedMatrix<ValType, N> &mt, TVector<ValType, VecAllocType> &b)
+{
+	if (b.GetSize() != N)
+	{
+		throw std::runtime_error("Can't solve system with right-hand side of different size");
+	}
+	const ValType *a = mt.data();
+	for (TIndex i = 0; i < N; ++i)
+	{
+		if (a[PackedOffset(i, i, N)] == ValType())
+		{
+			throw std::runtime_error("Can't solve system with zero pivot");
+		}
+	}
+	ValType *x = b.data();
+	Unroll<N>([&](auto r)
+	{
+		constexpr TIndex I = N - 1 - decltype(r)::value; // снизу вверх
+		ValType s = x[I];
+		Unroll<N - 1 - I>([&](auto dj)
+		{
+			constexpr TIndex J = I + 1 + decltype(dj)::value;
+			s -= a[PackedOffset(I, J, N)] * x[J];
+		});
+		x[I] = s / a[PackedOffset(I, I, N)];
+	});
+} /*-------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,50 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_index.h
+//
+// Тип индексов и размеров и арифметика смещений упакованного треугольника.
+// Треугольник порядка n хранит n(n + 1)/2 элементов - при n > 65535 это
+// больше 2^31, поэтому размеры, индексы и смещения имеют знаковый тип
+// разрядности указателя, а не int. Знаковый тип оставлен ради циклов
+// вида for (i = n - 1; i >= 0; --i) и разностей индексов.
+
+#ifndef __TMATRIX_INDEX_H__
+#define __TMATRIX_INDEX_H__
+
+#include <cstddef>
+
+typedef std::ptrdiff_t TIndex;
+
+// Ограничения размеров. Значения по умолчанию - из интерфейса лабораторной;
+// для больших задач (порядок матрицы до сотен тысяч) их задают при сборке,
+// например -DUTMATRIX_MAX_MATRIX_SIZE=200000. Размеры и индексы имеют тип
+// TIndex, поэтому смещения в треугольнике больше 2^31 элементов не
+// переполняются.
+#ifndef UTMATRIX_MAX_VECTOR_SIZE
+#define UTMATRIX_MAX_VECTOR_SIZE 100000000
+#endif
+#ifndef UTMATRIX_MAX_MATRIX_SIZE
+#define UTMATRIX_MAX_MATRIX_SIZE 10000
+#endif
+const TIndex MAX_VECTOR_SIZE = UTMATRIX_MAX_VECTOR_SIZE;
+const TIndex MAX_MATRIX_SIZE = UTMATRIX_MAX_MATRIX_SIZE;
+
+// Смещение строки i в упакованном буфере матрицы порядка n
+constexpr TIndex PackedRowOffset(TIndex i, TIndex n)
+{
+	return i * (2 * n - i + 1) / 2;
+}
+
+// Смещение элемента (i, j) в упакованном буфере матрицы порядка n
+constexpr TIndex PackedOffset(TIndex i, TIndex j, TIndex n)
+{
+	return PackedRowOffset(i, n) + j - i;
+}
+
+// Число элементов треугольника порядка n
+constexpr TIndex PackedCount(TIndex n)
+{
+	return n * (n + 1) / 2;
+}
+
+#endif
@@ -0,0 +1,203 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_mmap.h
+//
+// Внешние буферы матриц: отображение файла в память. Матрица, построенная
+// над отображением (TMatrix::MapFile), не читает файл при создании -
+// страницы подгружаются при первом обращении.
+
+#ifndef __TMATRIX_MMAP_H__
+#define __TMATRIX_MMAP_H__
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Владелец буфера, не выделенного распределителем матрицы; буфер
+// освобождается деструктором
+class TExternalStorage
+{
+public:
+  virtual ~TExternalStorage() {}
+  virtual void Sync() {} // сохранить изменения буфера
+};
+
+// Режим отображения файла
+enum TMapMode
+{
+  MAP_READ_ONLY, // изменения остаются в памяти процесса и не попадают в файл
+  MAP_READ_WRITE // изменения записываются в файл (Sync - немедленно)
+};
+
+class TMappedFile : public TExternalStorage
+{
+  char *pData;
+  size_t Length;
+#if defined(_WIN32)
+  HANDLE hFile, hMapping;
+#else
+  int File;
+#endif
+  void Close();
+public:
+  // при create > 0 создается (или перезаписывается) файл такой длины
+  TMappedFile(const std::string &path, TMapMode mode, size_t create = 0);
+  TMappedFile(const TMappedFile&) = delete;
+  TMappedFile& operator=(const TMappedFile&) = delete;
+  ~TMappedFile() { Close(); }
+  char* GetData() const { return pData; }
+  size_t GetLength() const { return Length; }
+  void Sync();
+};
+
+#if defined(_WIN32)
+
+inline TMappedFile::TMappedFile(const std::string &path, TMapMode mode, size_t create)
+	: pData(nullptr), Length(0), hFile(INVALID_HANDLE_VALUE), hMapping(nullptr)
+{
+	const bool write = (mode == MAP_READ_WRITE) || create > 0;
+	hFile = CreateFileA(path.c_str(), write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+		FILE_SHARE_READ, nullptr, create > 0 ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Can't open file for mapping");
+	}
+	LARGE_INTEGER size;
+	if (create > 0)
+	{
+		size.QuadPart = (LONGLONG)create;
+	}
+	else if (!GetFileSizeEx(hFile, &size))
+	{
+		Close();
+		throw std::runtime_error("Can't open file for mapping");
+	}
+	Length = (size_t)size.QuadPart;
+	if (Length == 0)
+	{
+		Close();
+		throw std::runtime_error("Can't map empty file");
+	}
+	// PAGE_WRITECOPY дает закрытую копию изменяемых страниц
+	hMapping = CreateFileMappingA(hFile, nullptr, write ? PAGE_READWRITE : PAGE_WRITECOPY,
+		size.HighPart, size.LowPart, nullptr);
+	if (hMapping != nullptr)
+	{
+		pData = static_cast<char*>(MapViewOfFile(hMapping, write ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, Length));
+	}
+	if (pData == nullptr)
+	{
+		Close();
+		throw std::runtime_error("Can't map file");
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void TMappedFile::Close()
+{
+	if (pData != nullptr)
+	{
+		UnmapViewOfFile(pData);
+		pData = nullptr;
+	}
+	if (hMapping != nullptr)
+	{
+		CloseHandle(hMapping);
+		hMapping = nullptr;
+	}
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(hFile);
+		hFile = INVALID_HANDLE_VALUE;
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void TMappedFile::Sync()
+{
+	if (!FlushViewOfFile(pData, Length))
+	{
+		throw std::runtime_error("Can't sync mapped file");
+	}
+} /*-------------------------------------------------------------------------*/
+
+#else
+
+inline TMappedFile::TMappedFile(const std::string &path, TMapMode mode, size_t create)
+	: pData(nullptr), Length(0), File(-1)
+{
+	const bool write = (mode == MAP_READ_WRITE) || create > 0;
+	File = open(path.c_str(), write ? (create > 0 ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR) : O_RDONLY, 0644);
+	if (File < 0)
+	{
+		throw std::runtime_error("Can't open file for mapping");
+	}
+	if (create > 0)
+	{
+		if (ftruncate(File, (off_t)create) != 0)
+		{
+			Close();
+			throw std::runtime_error("Can't resize file for mapping");
+		}
+		Length = create;
+	}
+	else
+	{
+		struct stat info;
+		if (fstat(File, &info) != 0)
+		{
+			Close();
+			throw std::runtime_error("Can't open file for mapping");
+		}
+		Length = (size_t)info.st_size;
+	}
+	if (Length == 0)
+	{
+		Close();
+		throw std::runtime_error("Can't map empty file");
+	}
+	// MAP_PRIVATE: изменения получают закрытые копии страниц
+	void *p = mmap(nullptr, Length, PROT_READ | PROT_WRITE, write ? MAP_SHARED : MAP_PRIVATE, File, 0);
+	if (p == MAP_FAILED)
+	{
+		Close();
+		throw std::runtime_error("Can't map file");
+	}
+	pData = static_cast<char*>(p);
+} /*-------------------------------------------------------------------------*/
+
+inline void TMappedFile::Close()
+{
+	if (pData != nullptr)
+	{
+		munmap(pData, Length);
+		pData = nullptr;
+	}
+	if (File >= 0)
+	{
+		close(File);
+		File = -1;
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void TMappedFile::Sync()
+{
+	if (msync(pData, Length, MS_SYNC) != 0)
+	{
+		throw std::runtime_error("Can't sync mapped file");
+	}
+} /*-------------------------------------------------------------------------*/
+
+#endif
+
+#endif
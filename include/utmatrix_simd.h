@@ -0,0 +1,521 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_simd.h
+//
+// Векторизованные ядра для непрерывных массивов float, double, int32 и
+// int64: сложение, вычитание, операции со скаляром, axpy, скалярное
+// произведение, а также axpy сразу в четыре строки для умножения матриц.
+// Варианты SSE2, AVX2 и AVX-512 выбираются при первом обращении по
+// результатам cpuid; для остальных типов и процессоров используется
+// переносимый скалярный цикл.
+
+#ifndef __TMATRIX_SIMD_H__
+#define __TMATRIX_SIMD_H__
+
+#include <cstdint>
+#include <type_traits>
+#include "utmatrix_index.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define UTMATRIX_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Уровень набора инструкций
+enum TSimdLevel
+{
+  SIMD_SCALAR = 0,
+  SIMD_SSE2   = 1,
+  SIMD_AVX2   = 2,
+  SIMD_AVX512 = 3
+};
+
+// Таблица ядер для одного типа элементов
+template <class T>
+struct TSimdKernels
+{
+  void (*Add)(T *pDst, const T *pA, const T *pB, TIndex n);    // dst = a + b
+  void (*Sub)(T *pDst, const T *pA, const T *pB, TIndex n);    // dst = a - b
+  void (*AddScalar)(T *pDst, const T *pA, T val, TIndex n);    // dst = a + val
+  void (*SubScalar)(T *pDst, const T *pA, T val, TIndex n);    // dst = a - val
+  void (*MulScalar)(T *pDst, const T *pA, T val, TIndex n);    // dst = a * val
+  void (*Axpy)(T *pDst, T alpha, const T *pX, TIndex n);       // dst += alpha * x
+  void (*Axpy4)(T *const *pDst, const T *pAlpha, const T *pX, TIndex n); // dst[r] += alpha[r] * x, r < 4
+  T    (*Dot)(const T *pA, const T *pB, TIndex n);             // (a, b)
+};
+
+// Типы, для которых есть векторизованные ядра
+template <class T>
+struct TSimdSupported
+{
+  static const bool value = std::is_same<T, float>::value || std::is_same<T, double>::value ||
+    std::is_same<T, std::int32_t>::value || std::is_same<T, std::int64_t>::value;
+};
+
+// Скалярные ядра - общий случай и запасной вариант
+template <class T>
+void ScalarAdd(T *pDst, const T *pA, const T *pB, TIndex n)
+{
+	for (TIndex k = 0; k < n; ++k)
+		pDst[k] = pA[k] + pB[k];
+}
+
+template <class T>
+void ScalarSub(T *pDst, const T *pA, const T *pB, TIndex n)
+{
+	for (TIndex k = 0; k < n; ++k)
+		pDst[k] = pA[k] - pB[k];
+}
+
+template <class T>
+void ScalarAddScalar(T *pDst, const T *pA, T val, TIndex n)
+{
+	for (TIndex k = 0; k < n; ++k)
+		pDst[k] = pA[k] + val;
+}
+
+template <class T>
+void ScalarSubScalar(T *pDst, const T *pA, T val, TIndex n)
+{
+	for (TIndex k = 0; k < n; ++k)
+		pDst[k] = pA[k] - val;
+}
+
+template <class T>
+void ScalarMulScalar(T *pDst, const T *pA, T val, TIndex n)
+{
+	for (TIndex k = 0; k < n; ++k)
+		pDst[k] = pA[k] * val;
+}
+
+template <class T>
+void ScalarAxpy(T *pDst, T alpha, const T *pX, TIndex n)
+{
+	for (TIndex k = 0; k < n; ++k)
+		pDst[k] += alpha * pX[k];
+}
+
+template <class T>
+void ScalarAxpy4(T *const *pDst, const T *pAlpha, const T *pX, TIndex n)
+{
+	for (TIndex k = 0; k < n; ++k)
+	{
+		const T x = pX[k];
+		pDst[0][k] += pAlpha[0] * x;
+		pDst[1][k] += pAlpha[1] * x;
+		pDst[2][k] += pAlpha[2] * x;
+		pDst[3][k] += pAlpha[3] * x;
+	}
+}
+
+template <class T>
+T ScalarDot(const T *pA, const T *pB, TIndex n)
+{
+	T aResult = 0;
+	for (TIndex k = 0; k < n; ++k)
+		aResult += pA[k] * pB[k];
+	return aResult;
+}
+
+#ifdef UTMATRIX_SIMD_X86
+
+// Ядра компилируются для своего набора инструкций независимо от ключей
+// компилятора; MSVC разрешает встроенные функции без атрибутов
+#if defined(__GNUC__) || defined(__clang__)
+#define UTMATRIX_TARGET_SSE2   __attribute__((target("sse2")))
+#define UTMATRIX_TARGET_AVX2   __attribute__((target("avx2")))
+#define UTMATRIX_TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+#else
+#define UTMATRIX_TARGET_SSE2
+#define UTMATRIX_TARGET_AVX2
+#define UTMATRIX_TARGET_AVX512
+#endif
+
+// Операции над регистрами: Load, Store, Set1, Zero, Add, Sub, Mul, Sum
+#define UTMATRIX_SIMD_OPS(NAME, TARGET, TYPE, VEC, WIDTH, LOAD, STORE, SET1, ZERO, ADD, SUB, MUL) \
+struct NAME \
+{ \
+  typedef TYPE T; \
+  typedef VEC V; \
+  enum { Width = WIDTH }; \
+  static TARGET V Load(const T *p) { return LOAD; } \
+  static TARGET void Store(T *p, V a) { STORE; } \
+  static TARGET V Set1(T val) { return SET1; } \
+  static TARGET V Zero() { return ZERO; } \
+  static TARGET V Add(V a, V b) { return ADD; } \
+  static TARGET V Sub(V a, V b) { return SUB; } \
+  static TARGET V Mul(V a, V b) { return MUL; } \
+  static TARGET T Sum(V a) \
+  { \
+	T aLanes[WIDTH]; \
+	Store(aLanes, a); \
+	T aResult = 0; \
+	for (int k = 0; k < WIDTH; ++k) \
+		aResult += aLanes[k]; \
+	return aResult; \
+  } \
+};
+
+// Умножение 64-битных (и в SSE2 - 32-битных) целых собирается из
+// беззнаковых произведений 32-битных половин; младшие разряды результата
+// от знака не зависят
+UTMATRIX_TARGET_SSE2 inline __m128i Sse2MulEpi32(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+UTMATRIX_TARGET_SSE2 inline __m128i Sse2MulEpi64(__m128i a, __m128i b)
+{
+	__m128i cross = _mm_add_epi64(_mm_mul_epu32(a, _mm_srli_epi64(b, 32)),
+		_mm_mul_epu32(_mm_srli_epi64(a, 32), b));
+	return _mm_add_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(cross, 32));
+}
+
+UTMATRIX_TARGET_AVX2 inline __m256i Avx2MulEpi64(__m256i a, __m256i b)
+{
+	__m256i cross = _mm256_add_epi64(_mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)),
+		_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b));
+	return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+}
+
+UTMATRIX_SIMD_OPS(TSse2Float, UTMATRIX_TARGET_SSE2, float, __m128, 4,
+	_mm_loadu_ps(p), _mm_storeu_ps(p, a), _mm_set1_ps(val), _mm_setzero_ps(),
+	_mm_add_ps(a, b), _mm_sub_ps(a, b), _mm_mul_ps(a, b))
+UTMATRIX_SIMD_OPS(TSse2Double, UTMATRIX_TARGET_SSE2, double, __m128d, 2,
+	_mm_loadu_pd(p), _mm_storeu_pd(p, a), _mm_set1_pd(val), _mm_setzero_pd(),
+	_mm_add_pd(a, b), _mm_sub_pd(a, b), _mm_mul_pd(a, b))
+UTMATRIX_SIMD_OPS(TSse2Int32, UTMATRIX_TARGET_SSE2, std::int32_t, __m128i, 4,
+	_mm_loadu_si128((const __m128i*)p), _mm_storeu_si128((__m128i*)p, a), _mm_set1_epi32(val), _mm_setzero_si128(),
+	_mm_add_epi32(a, b), _mm_sub_epi32(a, b), Sse2MulEpi32(a, b))
+UTMATRIX_SIMD_OPS(TSse2Int64, UTMATRIX_TARGET_SSE2, std::int64_t, __m128i, 2,
+	_mm_loadu_si128((const __m128i*)p), _mm_storeu_si128((__m128i*)p, a), _mm_set1_epi64x(val), _mm_setzero_si128(),
+	_mm_add_epi64(a, b), _mm_sub_epi64(a, b), Sse2MulEpi64(a, b))
+
+UTMATRIX_SIMD_OPS(TAvx2Float, UTMATRIX_TARGET_AVX2, float, __m256, 8,
+	_mm256_loadu_ps(p), _mm256_storeu_ps(p, a), _mm256_set1_ps(val), _mm256_setzero_ps(),
+	_mm256_add_ps(a, b), _mm256_sub_ps(a, b), _mm256_mul_ps(a, b))
+UTMATRIX_SIMD_OPS(TAvx2Double, UTMATRIX_TARGET_AVX2, double, __m256d, 4,
+	_mm256_loadu_pd(p), _mm256_storeu_pd(p, a), _mm256_set1_pd(val), _mm256_setzero_pd(),
+	_mm256_add_pd(a, b), _mm256_sub_pd(a, b), _mm256_mul_pd(a, b))
+UTMATRIX_SIMD_OPS(TAvx2Int32, UTMATRIX_TARGET_AVX2, std::int32_t, __m256i, 8,
+	_mm256_loadu_si256((const __m256i*)p), _mm256_storeu_si256((__m256i*)p, a), _mm256_set1_epi32(val), _mm256_setzero_si256(),
+	_mm256_add_epi32(a, b), _mm256_sub_epi32(a, b), _mm256_mullo_epi32(a, b))
+UTMATRIX_SIMD_OPS(TAvx2Int64, UTMATRIX_TARGET_AVX2, std::int64_t, __m256i, 4,
+	_mm256_loadu_si256((const __m256i*)p), _mm256_storeu_si256((__m256i*)p, a), _mm256_set1_epi64x(val), _mm256_setzero_si256(),
+	_mm256_add_epi64(a, b), _mm256_sub_epi64(a, b), Avx2MulEpi64(a, b))
+
+UTMATRIX_SIMD_OPS(TAvx512Float, UTMATRIX_TARGET_AVX512, float, __m512, 16,
+	_mm512_loadu_ps(p), _mm512_storeu_ps(p, a), _mm512_set1_ps(val), _mm512_setzero_ps(),
+	_mm512_add_ps(a, b), _mm512_sub_ps(a, b), _mm512_mul_ps(a, b))
+UTMATRIX_SIMD_OPS(TAvx512Double, UTMATRIX_TARGET_AVX512, double, __m512d, 8,
+	_mm512_loadu_pd(p), _mm512_storeu_pd(p, a), _mm512_set1_pd(val), _mm512_setzero_pd(),
+	_mm512_add_pd(a, b), _mm512_sub_pd(a, b), _mm512_mul_pd(a, b))
+UTMATRIX_SIMD_OPS(TAvx512Int32, UTMATRIX_TARGET_AVX512, std::int32_t, __m512i, 16,
+	_mm512_loadu_si512(p), _mm512_storeu_si512(p, a), _mm512_set1_epi32(val), _mm512_setzero_si512(),
+	_mm512_add_epi32(a, b), _mm512_sub_epi32(a, b), _mm512_mullo_epi32(a, b))
+UTMATRIX_SIMD_OPS(TAvx512Int64, UTMATRIX_TARGET_AVX512, std::int64_t, __m512i, 8,
+	_mm512_loadu_si512(p), _mm512_storeu_si512(p, a), _mm512_set1_epi64(val), _mm512_setzero_si512(),
+	_mm512_add_epi64(a, b), _mm512_sub_epi64(a, b), _mm512_mullo_epi64(a, b))
+
+// Ядра над операциями OPS; хвост короче ширины регистра - скалярный
+#define UTMATRIX_SIMD_KERNELS(NAME, TARGET, OPS) \
+struct NAME \
+{ \
+  typedef OPS::T T; \
+  typedef OPS::V V; \
+  static TARGET void Add(T *pDst, const T *pA, const T *pB, TIndex n) \
+  { \
+	TIndex k = 0; \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+		OPS::Store(pDst + k, OPS::Add(OPS::Load(pA + k), OPS::Load(pB + k))); \
+	ScalarAdd(pDst + k, pA + k, pB + k, n - k); \
+  } \
+  static TARGET void Sub(T *pDst, const T *pA, const T *pB, TIndex n) \
+  { \
+	TIndex k = 0; \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+		OPS::Store(pDst + k, OPS::Sub(OPS::Load(pA + k), OPS::Load(pB + k))); \
+	ScalarSub(pDst + k, pA + k, pB + k, n - k); \
+  } \
+  static TARGET void AddScalar(T *pDst, const T *pA, T val, TIndex n) \
+  { \
+	V v = OPS::Set1(val); \
+	TIndex k = 0; \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+		OPS::Store(pDst + k, OPS::Add(OPS::Load(pA + k), v)); \
+	ScalarAddScalar(pDst + k, pA + k, val, n - k); \
+  } \
+  static TARGET void SubScalar(T *pDst, const T *pA, T val, TIndex n) \
+  { \
+	V v = OPS::Set1(val); \
+	TIndex k = 0; \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+		OPS::Store(pDst + k, OPS::Sub(OPS::Load(pA + k), v)); \
+	ScalarSubScalar(pDst + k, pA + k, val, n - k); \
+  } \
+  static TARGET void MulScalar(T *pDst, const T *pA, T val, TIndex n) \
+  { \
+	V v = OPS::Set1(val); \
+	TIndex k = 0; \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+		OPS::Store(pDst + k, OPS::Mul(OPS::Load(pA + k), v)); \
+	ScalarMulScalar(pDst + k, pA + k, val, n - k); \
+  } \
+  static TARGET void Axpy(T *pDst, T alpha, const T *pX, TIndex n) \
+  { \
+	V v = OPS::Set1(alpha); \
+	TIndex k = 0; \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+		OPS::Store(pDst + k, OPS::Add(OPS::Load(pDst + k), OPS::Mul(v, OPS::Load(pX + k)))); \
+	ScalarAxpy(pDst + k, alpha, pX + k, n - k); \
+  } \
+  static TARGET void Axpy4(T *const *pDst, const T *pAlpha, const T *pX, TIndex n) \
+  { \
+	T *d0 = pDst[0], *d1 = pDst[1], *d2 = pDst[2], *d3 = pDst[3]; \
+	V a0 = OPS::Set1(pAlpha[0]), a1 = OPS::Set1(pAlpha[1]); \
+	V a2 = OPS::Set1(pAlpha[2]), a3 = OPS::Set1(pAlpha[3]); \
+	TIndex k = 0; \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+	{ \
+		V x = OPS::Load(pX + k); \
+		OPS::Store(d0 + k, OPS::Add(OPS::Load(d0 + k), OPS::Mul(a0, x))); \
+		OPS::Store(d1 + k, OPS::Add(OPS::Load(d1 + k), OPS::Mul(a1, x))); \
+		OPS::Store(d2 + k, OPS::Add(OPS::Load(d2 + k), OPS::Mul(a2, x))); \
+		OPS::Store(d3 + k, OPS::Add(OPS::Load(d3 + k), OPS::Mul(a3, x))); \
+	} \
+	T *aTail[4] = { d0 + k, d1 + k, d2 + k, d3 + k }; \
+	ScalarAxpy4(aTail, pAlpha, pX + k, n - k); \
+  } \
+  static TARGET T Dot(const T *pA, const T *pB, TIndex n) \
+  { \
+	V s0 = OPS::Zero(), s1 = OPS::Zero(), s2 = OPS::Zero(), s3 = OPS::Zero(); \
+	TIndex k = 0; \
+	for (; k + 4 * OPS::Width <= n; k += 4 * OPS::Width) \
+	{ \
+		s0 = OPS::Add(s0, OPS::Mul(OPS::Load(pA + k), OPS::Load(pB + k))); \
+		s1 = OPS::Add(s1, OPS::Mul(OPS::Load(pA + k + OPS::Width), OPS::Load(pB + k + OPS::Width))); \
+		s2 = OPS::Add(s2, OPS::Mul(OPS::Load(pA + k + 2 * OPS::Width), OPS::Load(pB + k + 2 * OPS::Width))); \
+		s3 = OPS::Add(s3, OPS::Mul(OPS::Load(pA + k + 3 * OPS::Width), OPS::Load(pB + k + 3 * OPS::Width))); \
+	} \
+	for (; k + OPS::Width <= n; k += OPS::Width) \
+		s0 = OPS::Add(s0, OPS::Mul(OPS::Load(pA + k), OPS::Load(pB + k))); \
+	return OPS::Sum(OPS::Add(OPS::Add(s0, s1), OPS::Add(s2, s3))) + ScalarDot(pA + k, pB + k, n - k); \
+  } \
+};
+
+UTMATRIX_SIMD_KERNELS(TSse2FloatKernels, UTMATRIX_TARGET_SSE2, TSse2Float)
+UTMATRIX_SIMD_KERNELS(TSse2DoubleKernels, UTMATRIX_TARGET_SSE2, TSse2Double)
+UTMATRIX_SIMD_KERNELS(TSse2Int32Kernels, UTMATRIX_TARGET_SSE2, TSse2Int32)
+UTMATRIX_SIMD_KERNELS(TSse2Int64Kernels, UTMATRIX_TARGET_SSE2, TSse2Int64)
+UTMATRIX_SIMD_KERNELS(TAvx2FloatKernels, UTMATRIX_TARGET_AVX2, TAvx2Float)
+UTMATRIX_SIMD_KERNELS(TAvx2DoubleKernels, UTMATRIX_TARGET_AVX2, TAvx2Double)
+UTMATRIX_SIMD_KERNELS(TAvx2Int32Kernels, UTMATRIX_TARGET_AVX2, TAvx2Int32)
+UTMATRIX_SIMD_KERNELS(TAvx2Int64Kernels, UTMATRIX_TARGET_AVX2, TAvx2Int64)
+UTMATRIX_SIMD_KERNELS(TAvx512FloatKernels, UTMATRIX_TARGET_AVX512, TAvx512Float)
+UTMATRIX_SIMD_KERNELS(TAvx512DoubleKernels, UTMATRIX_TARGET_AVX512, TAvx512Double)
+UTMATRIX_SIMD_KERNELS(TAvx512Int32Kernels, UTMATRIX_TARGET_AVX512, TAvx512Int32)
+UTMATRIX_SIMD_KERNELS(TAvx512Int64Kernels, UTMATRIX_TARGET_AVX512, TAvx512Int64)
+
+// Соответствие (уровень, тип) -> набор ядер
+template <class T, TSimdLevel Level> struct TSimdKernelSet;
+template <> struct TSimdKernelSet<float, SIMD_SSE2> : TSse2FloatKernels {};
+template <> struct TSimdKernelSet<double, SIMD_SSE2> : TSse2DoubleKernels {};
+template <> struct TSimdKernelSet<std::int32_t, SIMD_SSE2> : TSse2Int32Kernels {};
+template <> struct TSimdKernelSet<std::int64_t, SIMD_SSE2> : TSse2Int64Kernels {};
+template <> struct TSimdKernelSet<float, SIMD_AVX2> : TAvx2FloatKernels {};
+template <> struct TSimdKernelSet<double, SIMD_AVX2> : TAvx2DoubleKernels {};
+template <> struct TSimdKernelSet<std::int32_t, SIMD_AVX2> : TAvx2Int32Kernels {};
+template <> struct TSimdKernelSet<std::int64_t, SIMD_AVX2> : TAvx2Int64Kernels {};
+template <> struct TSimdKernelSet<float, SIMD_AVX512> : TAvx512FloatKernels {};
+template <> struct TSimdKernelSet<double, SIMD_AVX512> : TAvx512DoubleKernels {};
+template <> struct TSimdKernelSet<std::int32_t, SIMD_AVX512> : TAvx512Int32Kernels {};
+template <> struct TSimdKernelSet<std::int64_t, SIMD_AVX512> : TAvx512Int64Kernels {};
+
+#endif // UTMATRIX_SIMD_X86
+
+// Уровень, поддерживаемый процессором и операционной системой
+inline TSimdLevel DetectSimdLevel()
+{
+#if defined(UTMATRIX_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+		return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SIMD_SSE2;
+	return SIMD_SCALAR;
+#elif defined(UTMATRIX_SIMD_X86) && defined(_MSC_VER)
+	int aInfo[4];
+	__cpuid(aInfo, 0);
+	const int maxLeaf = aInfo[0];
+	__cpuid(aInfo, 1);
+	const bool sse2 = (aInfo[3] & (1 << 26)) != 0;
+	const bool osxsave = (aInfo[2] & (1 << 27)) != 0;
+	const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	if (maxLeaf >= 7 && (xcr0 & 0x6) == 0x6)
+	{
+		__cpuidex(aInfo, 7, 0);
+		const bool avx2 = (aInfo[1] & (1 << 5)) != 0;
+		const bool avx512 = (aInfo[1] & (1 << 16)) != 0 && (aInfo[1] & (1 << 17)) != 0;
+		if (avx512 && (xcr0 & 0xE6) == 0xE6)
+			return SIMD_AVX512;
+		if (avx2)
+			return SIMD_AVX2;
+	}
+	return sse2 ? SIMD_SSE2 : SIMD_SCALAR;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+// Таблица ядер заданного уровня
+#ifdef UTMATRIX_SIMD_X86
+template <class T, class SetType>
+TSimdKernels<T> MakeSimdKernels()
+{
+	TSimdKernels<T> aTable = { SetType::Add, SetType::Sub, SetType::AddScalar, SetType::SubScalar,
+		SetType::MulScalar, SetType::Axpy, SetType::Axpy4, SetType::Dot };
+	return aTable;
+}
+#endif
+
+template <class T>
+TSimdKernels<T> SelectSimdKernels(TSimdLevel level)
+{
+#ifdef UTMATRIX_SIMD_X86
+	if constexpr (TSimdSupported<T>::value)
+	{
+		switch (level)
+		{
+		case SIMD_AVX512:
+			return MakeSimdKernels<T, TSimdKernelSet<T, SIMD_AVX512> >();
+		case SIMD_AVX2:
+			return MakeSimdKernels<T, TSimdKernelSet<T, SIMD_AVX2> >();
+		case SIMD_SSE2:
+			return MakeSimdKernels<T, TSimdKernelSet<T, SIMD_SSE2> >();
+		default:
+			break;
+		}
+	}
+#endif
+	TSimdKernels<T> aTable = { ScalarAdd<T>, ScalarSub<T>, ScalarAddScalar<T>, ScalarSubScalar<T>,
+		ScalarMulScalar<T>, ScalarAxpy<T>, ScalarAxpy4<T>, ScalarDot<T> };
+	return aTable;
+}
+
+// Текущий уровень и таблица ядер; по умолчанию - лучший доступный
+inline TSimdLevel& CurrentSimdLevel()
+{
+	static TSimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+template <class T>
+TSimdKernels<T>& CurrentSimdKernels()
+{
+	static TSimdKernels<T> aTable = SelectSimdKernels<T>(CurrentSimdLevel());
+	return aTable;
+}
+
+inline TSimdLevel GetSimdLevel()
+{
+	return CurrentSimdLevel();
+}
+
+// Ограничение уровня (для тестов и замеров); уровень выше доступного
+// понижается до доступного. Вызывать, пока не идут вычисления в других потоках
+inline void SetSimdLevel(TSimdLevel level)
+{
+	if (level > DetectSimdLevel())
+	{
+		level = DetectSimdLevel();
+	}
+	CurrentSimdLevel() = level;
+	CurrentSimdKernels<float>() = SelectSimdKernels<float>(level);
+	CurrentSimdKernels<double>() = SelectSimdKernels<double>(level);
+	CurrentSimdKernels<std::int32_t>() = SelectSimdKernels<std::int32_t>(level);
+	CurrentSimdKernels<std::int64_t>() = SelectSimdKernels<std::int64_t>(level);
+}
+
+// Точки входа: векторизованное ядро для поддерживаемых типов,
+// скалярный цикл для остальных
+template <class T>
+inline void VecAdd(T *pDst, const T *pA, const T *pB, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		CurrentSimdKernels<T>().Add(pDst, pA, pB, n);
+	else
+		ScalarAdd(pDst, pA, pB, n);
+}
+
+template <class T>
+inline void VecSub(T *pDst, const T *pA, const T *pB, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		CurrentSimdKernels<T>().Sub(pDst, pA, pB, n);
+	else
+		ScalarSub(pDst, pA, pB, n);
+}
+
+template <class T>
+inline void VecAddScalar(T *pDst, const T *pA, const T &val, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		CurrentSimdKernels<T>().AddScalar(pDst, pA, val, n);
+	else
+		ScalarAddScalar(pDst, pA, val, n);
+}
+
+template <class T>
+inline void VecSubScalar(T *pDst, const T *pA, const T &val, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		CurrentSimdKernels<T>().SubScalar(pDst, pA, val, n);
+	else
+		ScalarSubScalar(pDst, pA, val, n);
+}
+
+template <class T>
+inline void VecMulScalar(T *pDst, const T *pA, const T &val, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		CurrentSimdKernels<T>().MulScalar(pDst, pA, val, n);
+	else
+		ScalarMulScalar(pDst, pA, val, n);
+}
+
+template <class T>
+inline void VecAxpy(T *pDst, const T &alpha, const T *pX, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		CurrentSimdKernels<T>().Axpy(pDst, alpha, pX, n);
+	else
+		ScalarAxpy(pDst, alpha, pX, n);
+}
+
+template <class T>
+inline void VecAxpy4(T *const *pDst, const T *pAlpha, const T *pX, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		CurrentSimdKernels<T>().Axpy4(pDst, pAlpha, pX, n);
+	else
+		ScalarAxpy4(pDst, pAlpha, pX, n);
+}
+
+template <class T>
+inline T VecDot(const T *pA, const T *pB, TIndex n)
+{
+	if constexpr (TSimdSupported<T>::value)
+		return CurrentSimdKernels<T>().Dot(pA, pB, n);
+	else
+		return ScalarDot(pA, pB, n);
+}
+
+#endif
@@ -0,0 +1,296 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_stream.h
+//
+// Поэлементные операции над матрицами в файлах двоичного формата
+// (utmatrix_binary.h) без загрузки матриц в память. Файлы читаются и
+// пишутся блоками целых строк; пока обрабатывается один блок, следующий
+// читается, а предыдущий результат записывается в фоне (двойная
+// буферизация). Память ограничена несколькими блоками независимо от
+// порядка матрицы; сам порядок, как и при загрузке матрицы, меньше
+// MAX_MATRIX_SIZE (utmatrix_index.h).
+//
+//   StreamAdd<double>("a.bin", "b.bin", "c.bin"); // c = a + b
+
+#ifndef __TMATRIX_STREAM_H__
+#define __TMATRIX_STREAM_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "utmatrix_binary.h"
+#include "utmatrix_index.h"
+#include "utmatrix_simd.h"
+
+const size_t STREAM_BLOCK_BYTES = 1 << 20; // объем блока строк одного файла
+
+// Конец блока строк, начинающегося со строки row матрицы порядка n: не
+// больше blockElements элементов, но не меньше одной строки
+inline int64_t StreamBlockEnd(int64_t row, int64_t n, size_t blockElements)
+{
+	int64_t end = row + 1;
+	for (size_t count = (size_t)(n - row); end < n && count + (size_t)(n - end) <= blockElements; ++end)
+	{
+		count += (size_t)(n - end);
+	}
+	return end;
+}
+
+// Чтение упакованных строк матрицы из файла двоичного формата
+template <class ValType>
+class TRowStreamReader
+{
+  std::ifstream In;
+  int64_t Size;                    // порядок матрицы
+  size_t BlockElements;
+  int64_t Row, RowEnd;             // строки текущего блока
+  int64_t NextRow;                 // первая строка читаемого в фоне блока
+  std::vector<ValType> Buffer[2];
+  int Current;                     // буфер текущего блока
+  TBinaryChecksum Checksum;
+  uint64_t ExpectedChecksum;
+  std::future<int64_t> Pending;    // чтение следующего блока: его последняя строка
+
+  int64_t ReadBlock(int64_t row, std::vector<ValType> &buffer);
+  void WaitPending();
+public:
+  explicit TRowStreamReader(const std::string &path, size_t blockBytes = STREAM_BLOCK_BYTES);
+  TRowStreamReader(const TRowStreamReader&) = delete;
+  TRowStreamReader& operator=(const TRowStreamReader&) = delete;
+  ~TRowStreamReader() { WaitPending(); }
+  int64_t GetSize() const { return Size; }
+  // следующий блок; false - строки кончились (контрольная сумма сверена)
+  bool NextBlock();
+  int64_t GetRow() const { return Row; }       // первая строка блока
+  int64_t GetRowEnd() const { return RowEnd; } // строка после блока
+  const ValType* GetData() const { return Buffer[Current].data(); } // строки блока подряд
+  size_t GetCount() const { return Buffer[Current].size(); }        // число элементов блока
+};
+
+// Запись упакованных строк матрицы в файл двоичного формата
+template <class ValType>
+class TRowStreamWriter
+{
+  std::ofstream Out;
+  int64_t Size;
+  uint64_t Written;                // записано элементов
+  TBinaryChecksum Checksum;
+  std::future<void> Pending;       // запись предыдущего блока
+
+  void WaitPending();
+public:
+  TRowStreamWriter(const std::string &path, int64_t n);
+  TRowStreamWriter(const TRowStreamWriter&) = delete;
+  TRowStreamWriter& operator=(const TRowStreamWriter&) = delete;
+  ~TRowStreamWriter();
+  // запись count элементов в фоне; p не должен меняться до следующего
+  // вызова Write или Close
+  void Write(const ValType *p, size_t count);
+  void Close();                    // дописать заголовок; все строки должны быть записаны
+};
+
+template <class ValType>
+TRowStreamReader<ValType>::TRowStreamReader(const std::string &path, size_t blockBytes)
+	: In(path.c_str(), std::ios::binary), Size(0),
+	  BlockElements(std::max(blockBytes / sizeof(ValType), (size_t)1)),
+	  Row(0), RowEnd(0), NextRow(0), Current(0), ExpectedChecksum(0)
+{
+	if (!In)
+	{
+		throw std::runtime_error("Can't open file " + path);
+	}
+	const TBinaryHeader h = ReadBinaryHeader(In);
+	CheckBinaryHeader<ValType>(h, LAYOUT_UPPER_PACKED);
+	// порядок проверяется до вычисления числа элементов; данные должны
+	// занимать весь остаток файла
+	const std::streampos data = In.tellg();
+	In.seekg(0, std::ios::end);
+	const std::streamoff length = In.tellg() - data;
+	In.seekg(data);
+	if (h.Size <= 0 || h.Size >= MAX_MATRIX_SIZE ||
+		h.DataSize != (uint64_t)PackedCount((TIndex)h.Size) * sizeof(ValType) ||
+		!In || length < 0 || (uint64_t)length != h.DataSize)
+	{
+		throw std::runtime_error("Can't load matrix with invalid size");
+	}
+	Size = h.Size;
+	ExpectedChecksum = h.Checksum;
+	Pending = std::async(std::launch::async, &TRowStreamReader::ReadBlock, this, (int64_t)0, std::ref(Buffer[1]));
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // чтение блока строк с row в buffer
+int64_t TRowStreamReader<ValType>::ReadBlock(int64_t row, std::vector<ValType> &buffer)
+{
+	const int64_t end = StreamBlockEnd(row, Size, BlockElements);
+	buffer.resize((size_t)((end - row) * (2 * Size - row - end + 1) / 2));
+	const std::streamsize bytes = (std::streamsize)(buffer.size() * sizeof(ValType));
+	if (!In.read(reinterpret_cast<char*>(buffer.data()), bytes))
+	{
+		throw std::runtime_error("Can't read binary data");
+	}
+	Checksum.Add(buffer.data(), (size_t)bytes);
+	return end;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+void TRowStreamReader<ValType>::WaitPending()
+{
+	if (Pending.valid())
+	{
+		Pending.wait();
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+bool TRowStreamReader<ValType>::NextBlock()
+{
+	if (!Pending.valid())
+	{
+		return false;
+	}
+	const int64_t end = Pending.get();
+	Current = 1 - Current;
+	Row = NextRow;
+	RowEnd = end;
+	NextRow = end;
+	if (end < Size)
+	{
+		Pending = std::async(std::launch::async, &TRowStreamReader::ReadBlock, this, end, std::ref(Buffer[1 - Current]));
+	}
+	else if (Checksum.Get() != ExpectedChecksum)
+	{
+		throw std::runtime_error("Can't load data with wrong checksum");
+	}
+	return true;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+TRowStreamWriter<ValType>::TRowStreamWriter(const std::string &path, int64_t n)
+	: Out(path.c_str(), std::ios::binary | std::ios::trunc), Size(n), Written(0)
+{
+	if (!Out)
+	{
+		throw std::runtime_error("Can't open file " + path);
+	}
+	if (Size <= 0 || Size >= MAX_MATRIX_SIZE)
+	{
+		throw std::runtime_error("Invalid size for matrix");
+	}
+	// место под заголовок; он записывается в Close
+	TBinaryHeader h;
+	std::memset(&h, 0, sizeof(h));
+	if (!Out.write(reinterpret_cast<const char*>(&h), sizeof(h)))
+	{
+		throw std::runtime_error("Can't write binary data");
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+TRowStreamWriter<ValType>::~TRowStreamWriter()
+{
+	// незакрытый файл остается с пустым заголовком и не читается
+	WaitPending();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+void TRowStreamWriter<ValType>::WaitPending()
+{
+	if (Pending.valid())
+	{
+		Pending.wait();
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+void TRowStreamWriter<ValType>::Write(const ValType *p, size_t count)
+{
+	if (Pending.valid())
+	{
+		Pending.get();
+	}
+	if (Written + count > (uint64_t)(Size * (Size + 1) / 2))
+	{
+		throw std::runtime_error("Can't write more elements than matrix has");
+	}
+	Written += count;
+	Pending = std::async(std::launch::async, [this, p, count]()
+	{
+		const std::streamsize bytes = (std::streamsize)(count * sizeof(ValType));
+		if (!Out.write(reinterpret_cast<const char*>(p), bytes))
+		{
+			throw std::runtime_error("Can't write binary data");
+		}
+		Checksum.Add(p, (size_t)bytes);
+	});
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+void TRowStreamWriter<ValType>::Close()
+{
+	if (Pending.valid())
+	{
+		Pending.get();
+	}
+	const uint64_t count = (uint64_t)(Size * (Size + 1) / 2);
+	if (Written != count)
+	{
+		throw std::runtime_error("Can't close matrix file before all rows are written");
+	}
+	const TBinaryHeader h = MakeBinaryHeader<ValType>(LAYOUT_UPPER_PACKED, Size, 0, count, Checksum.Get());
+	Out.seekp(0);
+	if (!Out.write(reinterpret_cast<const char*>(&h), sizeof(h)) || !Out.flush())
+	{
+		throw std::runtime_error("Can't write binary data");
+	}
+	Out.close();
+} /*-------------------------------------------------------------------------*/
+
+// c = f(a, b) над файлами двоичного формата: f(pC, pA, pB, count)
+// обрабатывает count элементов блока строк
+template <class ValType, class FuncType>
+void StreamTransform(const std::string &pathA, const std::string &pathB, const std::string &pathC,
+	FuncType f, size_t blockBytes = STREAM_BLOCK_BYTES)
+{
+	TRowStreamReader<ValType> a(pathA, blockBytes), b(pathB, blockBytes);
+	if (a.GetSize() != b.GetSize())
+	{
+		throw std::runtime_error("Can't process matrices of different size");
+	}
+	std::vector<ValType> aResult[2]; // разрушаются после c: запись в фоне читает их
+	TRowStreamWriter<ValType> c(pathC, a.GetSize());
+	for (int k = 0; a.NextBlock() && b.NextBlock(); k = 1 - k)
+	{
+		// aResult[1 - k] еще может записываться в фоне
+		aResult[k].resize(a.GetCount());
+		f(aResult[k].data(), a.GetData(), b.GetData(), (TIndex)a.GetCount());
+		c.Write(aResult[k].data(), aResult[k].size());
+	}
+	c.Close();
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // c = a + b
+void StreamAdd(const std::string &pathA, const std::string &pathB, const std::string &pathC,
+	size_t blockBytes = STREAM_BLOCK_BYTES)
+{
+	StreamTransform<ValType>(pathA, pathB, pathC, [](ValType *pC, const ValType *pA, const ValType *pB, TIndex n)
+	{
+		VecAdd(pC, pA, pB, n);
+	}, blockBytes);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // c = a - b
+void StreamSub(const std::string &pathA, const std::string &pathB, const std::string &pathC,
+	size_t blockBytes = STREAM_BLOCK_BYTES)
+{
+	StreamTransform<ValType>(pathA, pathB, pathC, [](ValType *pC, const ValType *pA, const ValType *pB, TIndex n)
+	{
+		VecSub(pC, pA, pB, n);
+	}, blockBytes);
+} /*-------------------------------------------------------------------------*/
+
+#endif
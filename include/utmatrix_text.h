@@ -0,0 +1,200 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_text.h
+//
+// Быстрый текстовый ввод-вывод чисел на std::to_chars / std::from_chars:
+// без локали и без разбора флагов формата потока для каждого элемента.
+// TTextWriter копит текст в своем буфере и передает его потоку крупными
+// блоками. TTextReader берет символы прямо из буфера потока (streambuf) и
+// не забирает ничего после последнего прочитанного числа, поэтому поток
+// можно читать дальше обычным образом.
+//
+// Числа с плавающей точкой выводятся кратчайшей записью, которая читается
+// обратно в то же значение (а не с точностью потока, как у operator<<).
+
+#ifndef __TMATRIX_TEXT_H__
+#define __TMATRIX_TEXT_H__
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+const size_t TEXT_BUFFER_SIZE = 1 << 16; // буфер TTextWriter
+const int TEXT_MAX_NUMBER = 128;         // наибольшая длина записи числа
+
+// Расположение элементов матрицы в тексте
+enum TTextLayout
+{
+  TEXT_TRIANGLE, // строка i: i табуляций и хранимые элементы, как у operator<<
+  TEXT_FULL      // строка i: все элементы, под диагональю нули
+};
+
+// Пробельный символ внутри строки текста
+inline bool IsTextSpace(int c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Разбор числа, занимающего весь диапазон [pBegin, pEnd)
+template <class ValType>
+bool ParseNumber(const char *pBegin, const char *pEnd, ValType &val);
+
+class TTextWriter
+{
+  std::ostream &Out;
+  std::vector<char> Buffer;
+  size_t Used; // занято в буфере
+public:
+  explicit TTextWriter(std::ostream &out, size_t bufferSize = TEXT_BUFFER_SIZE);
+  TTextWriter(const TTextWriter&) = delete;
+  TTextWriter& operator=(const TTextWriter&) = delete;
+  ~TTextWriter();                      // передает потоку остаток буфера
+  void Put(char c)
+  {
+	  if (Used == Buffer.size())
+		  Flush();
+	  Buffer[Used++] = c;
+  }
+  template <class ValType>
+  void Write(const ValType &val);      // число
+  void Flush();                        // передать буфер потоку
+};
+
+class TTextReader
+{
+  std::istream &In;
+  std::streambuf *pBuf;
+  [[noreturn]] void Fail(const char *message);
+public:
+  explicit TTextReader(std::istream &in) : In(in), pBuf(in.rdbuf()) {}
+  template <class ValType>
+  void Read(ValType &val);             // число после пробельных символов
+};
+
+inline void TTextReader::Fail(const char *message)
+{
+	// если поток сам бросает исключение при failbit, флаг не ставится:
+	// иначе вместо сообщения об ошибке разбора вышел бы std::ios_base::failure
+	if (!(In.exceptions() & std::ios::failbit))
+	{
+		In.setstate(std::ios::failbit);
+	}
+	throw std::runtime_error(message);
+} /*-------------------------------------------------------------------------*/
+
+inline TTextWriter::TTextWriter(std::ostream &out, size_t bufferSize)
+	: Out(out), Buffer(std::max(bufferSize, (size_t)TEXT_MAX_NUMBER)), Used(0)
+{
+} /*-------------------------------------------------------------------------*/
+
+inline TTextWriter::~TTextWriter()
+{
+	// ошибка записи остается в состоянии потока
+	if (Used > 0)
+	{
+		Out.write(Buffer.data(), (std::streamsize)Used);
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void TTextWriter::Flush()
+{
+	const size_t used = Used;
+	Used = 0;
+	if (used > 0 && !Out.write(Buffer.data(), (std::streamsize)used))
+	{
+		throw std::runtime_error("Can't write text");
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+void TTextWriter::Write(const ValType &val)
+{
+	static_assert(std::is_arithmetic<ValType>::value, "Only numbers can be written");
+	if (Buffer.size() - Used < (size_t)TEXT_MAX_NUMBER)
+	{
+		Flush();
+	}
+	if constexpr (std::is_same<ValType, bool>::value)
+	{
+		Buffer[Used++] = val ? '1' : '0';
+	}
+	else
+	{
+		char *pBegin = Buffer.data() + Used;
+		const std::to_chars_result r = std::to_chars(pBegin, pBegin + TEXT_MAX_NUMBER, val);
+		Used += r.ptr - pBegin;
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+void TTextReader::Read(ValType &val)
+{
+	static_assert(std::is_arithmetic<ValType>::value, "Only numbers can be read");
+	typedef std::char_traits<char> Traits;
+	int c = pBuf->sgetc();
+	while (c == '\n' || IsTextSpace(c))
+	{
+		c = pBuf->snextc();
+	}
+	char token[TEXT_MAX_NUMBER];
+	int length = 0;
+	while (!Traits::eq_int_type(c, Traits::eof()) && c != '\n' && !IsTextSpace(c))
+	{
+		if (length == TEXT_MAX_NUMBER)
+		{
+			Fail("Can't parse number: too long");
+		}
+		token[length++] = Traits::to_char_type(c);
+		c = pBuf->snextc();
+	}
+	if (Traits::eq_int_type(c, Traits::eof()))
+	{
+		In.setstate(std::ios::eofbit);
+	}
+	if (length == 0)
+	{
+		Fail("Can't read number: end of text");
+	}
+	if (!ParseNumber(token, token + length, val))
+	{
+		Fail("Can't parse number");
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+bool ParseNumber(const char *pBegin, const char *pEnd, ValType &val)
+{
+	static_assert(std::is_arithmetic<ValType>::value, "Only numbers can be read");
+	// from_chars не принимает знак '+', его пропускаем сами
+	if (pBegin != pEnd && *pBegin == '+')
+	{
+		++pBegin;
+		if (pBegin != pEnd && *pBegin == '-')
+		{
+			return false;
+		}
+	}
+	std::from_chars_result r;
+	if constexpr (std::is_same<ValType, bool>::value)
+	{
+		int digit = -1;
+		r = std::from_chars(pBegin, pEnd, digit);
+		if (digit != 0 && digit != 1)
+		{
+			return false;
+		}
+		val = digit == 1;
+	}
+	else
+	{
+		r = std::from_chars(pBegin, pEnd, val);
+	}
+	return r.ec == std::errc() && r.ptr == pEnd;
+} /*-------------------------------------------------------------------------*/
+
+#endif
@@ -0,0 +1,254 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_threads.h
+//
+// Пул потоков для поэлементных операций над матрицами и разбиение
+// треугольника на полосы строк с равным числом элементов. Длины строк
+// убывают от n до 1, поэтому при делении поровну по числу строк первая
+// полоса получала бы почти вдвое больше работы, чем в среднем.
+
+#ifndef __TMATRIX_THREADS_H__
+#define __TMATRIX_THREADS_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <algorithm>
+#include "utmatrix_index.h"
+
+const int PARALLEL_MIN_ELEMENTS = 1 << 16; // меньшие объемы обрабатываются в одном потоке
+
+// Пул потоков: Run(count, task) выполняет task(0) ... task(count - 1)
+// рабочими потоками и вызывающим потоком и возвращает управление, когда
+// все задачи завершены; свободный поток берет следующую невыданную задачу.
+// RunPinned отдает задачу t потоку t mod GetThreadCount() (вызывающий
+// поток - номер 0), так что одинаковые разбиения при разных вызовах
+// обрабатываются одними и теми же потоками - это нужно для размещения
+// страниц первым обращением. Первое возникшее исключение передается
+// вызывающему. Вызов из задачи или одновременно из другого потока
+// выполняется последовательно в вызывающем потоке.
+class TThreadPool
+{
+  std::vector<std::thread> Workers;
+  std::mutex Mutex;                    // защищает поля ниже
+  std::mutex RunMutex;                 // пул занят одним вызовом Run
+  std::condition_variable WakeUp;      // появились задачи или остановка
+  std::condition_variable Finished;    // выполнены все задачи
+  const std::function<void(int)> *pTask;
+  int TaskCount;                       // число задач текущего вызова
+  int NextTask;                        // первая невыданная задача
+  int Pending;                         // число невыполненных задач
+  bool Pinned;                         // задачи закреплены за потоками
+  unsigned Generation;                 // номер вызова Run
+  bool Stop;
+  std::exception_ptr Error;
+
+  static bool& InsideWorker()
+  {
+	  static thread_local bool inside = false;
+	  return inside;
+  }
+  void Work(int index, unsigned generation); // задачи вызова generation для потока index
+  void WorkerLoop(int index);
+  void Start(int count, const std::function<void(int)> &task, bool pinned);
+public:
+  explicit TThreadPool(int threads);   // threads - общее число потоков вместе с вызывающим
+  ~TThreadPool();
+  int GetThreadCount() const { return (int)Workers.size() + 1; }
+  void Run(int count, const std::function<void(int)> &task) { Start(count, task, false); }
+  void RunPinned(int count, const std::function<void(int)> &task) { Start(count, task, true); }
+};
+
+inline TThreadPool::TThreadPool(int threads)
+	: pTask(nullptr), TaskCount(0), NextTask(0), Pending(0), Pinned(false), Generation(0), Stop(false)
+{
+	for (int t = 1; t < threads; ++t)
+	{
+		Workers.push_back(std::thread(&TThreadPool::WorkerLoop, this, t));
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline TThreadPool::~TThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stop = true;
+	}
+	WakeUp.notify_all();
+	for (size_t t = 0; t < Workers.size(); ++t)
+	{
+		Workers[t].join();
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void TThreadPool::Work(int index, unsigned generation)
+{
+	const int step = GetThreadCount();
+	std::unique_lock<std::mutex> lock(Mutex);
+	int t = index;
+	for (;;)
+	{
+		// поток мог проснуться, когда вызов уже закончен и следующий Start
+		// сбросил NextTask: задачи чужого вызова не берутся
+		if (Generation != generation)
+		{
+			return;
+		}
+		if (!Pinned)
+		{
+			t = NextTask++;
+		}
+		if (t >= TaskCount)
+		{
+			return;
+		}
+		const std::function<void(int)> &task = *pTask;
+		lock.unlock();
+		std::exception_ptr error;
+		try
+		{
+			task(t);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		lock.lock();
+		if (error && !Error)
+		{
+			Error = error;
+		}
+		if (--Pending == 0)
+		{
+			Finished.notify_all();
+		}
+		if (Pinned)
+		{
+			t += step;
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void TThreadPool::WorkerLoop(int index)
+{
+	InsideWorker() = true;
+	unsigned seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			WakeUp.wait(lock, [&]() { return Stop || Generation != seen; });
+			if (Stop)
+			{
+				return;
+			}
+			seen = Generation;
+		}
+		Work(index, seen);
+	}
+} /*-------------------------------------------------------------------------*/
+
+inline void TThreadPool::Start(int count, const std::function<void(int)> &task, bool pinned)
+{
+	std::unique_lock<std::mutex> busy(RunMutex, std::try_to_lock);
+	if (Workers.empty() || InsideWorker() || !busy.owns_lock())
+	{
+		for (int t = 0; t < count; ++t)
+		{
+			task(t);
+		}
+		return;
+	}
+	unsigned generation;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		pTask = &task;
+		TaskCount = count;
+		NextTask = 0;
+		Pending = count;
+		Pinned = pinned;
+		Error = nullptr;
+		generation = ++Generation;
+	}
+	WakeUp.notify_all();
+	InsideWorker() = true;
+	Work(0, generation);
+	InsideWorker() = false;
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Finished.wait(lock, [&]() { return Pending == 0; });
+		pTask = nullptr;
+		TaskCount = 0;
+		error = Error;
+		Error = nullptr;
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+} /*-------------------------------------------------------------------------*/
+
+// Общий пул; по умолчанию вычисления идут в одном потоке
+inline std::unique_ptr<TThreadPool>& GlobalThreadPool()
+{
+	static std::unique_ptr<TThreadPool> pPool(new TThreadPool(1));
+	return pPool;
+}
+
+inline TThreadPool& ThreadPool()
+{
+	return *GlobalThreadPool();
+}
+
+inline int GetThreadCount()
+{
+	return ThreadPool().GetThreadCount();
+}
+
+// Задает число потоков (1 - последовательное выполнение, 0 - по числу
+// ядер). Вызывать, пока пул не используется
+inline void SetThreadCount(int count)
+{
+	if (count <= 0)
+	{
+		count = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	if (count != GetThreadCount())
+	{
+		GlobalThreadPool().reset(new TThreadPool(count));
+	}
+}
+
+// Границы parts полос строк треугольника порядка n с почти равным числом
+// элементов: полоса t - строки [aBounds[t], aBounds[t + 1])
+inline std::vector<TIndex> SplitTriangleRows(TIndex n, int parts)
+{
+	std::vector<TIndex> aBounds(parts + 1, n);
+	const TIndex total = PackedCount(n);
+	aBounds[0] = 0;
+	TIndex row = 0;
+	for (int t = 1; t < parts; ++t)
+	{
+		// первая строка, перед которой лежит не меньше t/parts элементов
+		const TIndex target = total * t / parts;
+		TIndex lo = row, hi = n;
+		while (lo < hi)
+		{
+			const TIndex mid = lo + (hi - lo) / 2;
+			if (PackedRowOffset(mid, n) < target)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		row = lo;
+		aBounds[t] = row;
+	}
+	return aBounds;
+}
+
+#endif
@@ -0,0 +1,574 @@
+﻿// ННГУ, ВМК, Курс "Методы программирования-2", С++, ООП
+//
+// utmatrix_view.h
+//
+// Представления частей верхнетреугольной матрицы без копирования: они
+// хранят указатель на упакованный буфер матрицы порядка N и границы части.
+//
+//   TTriangleView - треугольный диагональный блок (ведущий, замыкающий и т.д.);
+//   TBlockView    - прямоугольный блок над диагональю; строки блока лежат
+//                   в буфере подряд, переход к следующей строке - через
+//                   смещение строки матрицы;
+//   TStridedView  - столбец или диагональ: шаг между соседними элементами
+//                   уменьшается на 1 с каждой строкой.
+//
+// Операции над представлениями сводятся к векторизованным ядрам по строкам
+// (utmatrix_simd.h). Блочные алгоритмы (MultiplyAdd, SolveInPlace,
+// InvertInPlace) рекурсивно делят треугольник на ведущий и замыкающий
+// треугольники и блок между ними. Представление действительно, пока
+// матрица жива и не получает новый буфер.
+
+#ifndef __TMATRIX_VIEW_H__
+#define __TMATRIX_VIEW_H__
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "utmatrix_index.h"
+#include "utmatrix_simd.h"
+
+const TIndex VIEW_RECURSION_THRESHOLD = 64; // порядок, до которого треугольники не делятся
+
+template <class ValType>
+class TStridedView
+{
+  typedef typename std::remove_const<ValType>::type ElemType;
+  ValType *pFirst;
+  TIndex Size;
+  TIndex Stride; // шаг от элемента 0 к элементу 1
+public:
+  TStridedView(ValType *p, TIndex s, TIndex stride) : pFirst(p), Size(s), Stride(stride) {}
+  template <class OtherType>
+  TStridedView(const TStridedView<OtherType> &v)    // неконстантное -> константное
+    : pFirst(v.GetFirst()), Size(v.GetSize()), Stride(v.GetStride()) {}
+  ValType* GetFirst() const { return pFirst; }
+  TIndex GetSize() const { return Size; }
+  TIndex GetStride() const { return Stride; }
+  ValType& operator[](TIndex k) const { return pFirst[k * Stride - k * (k - 1) / 2]; } // без проверки
+  template <class FuncType>
+  void ForEach(FuncType f) const                    // f(k, элемент k) по порядку
+  {
+	  ValType *p = pFirst;
+	  for (TIndex k = 0; k < Size; p += Stride - k, ++k)
+		  f(k, *p);
+  }
+  const TStridedView& operator*=(const ElemType &val) const;
+  template <class OtherType>
+  const TStridedView& CopyFrom(const TStridedView<OtherType> &v) const;
+};
+
+template <class ValType>
+class TBlockView
+{
+  typedef typename std::remove_const<ValType>::type ElemType;
+  ValType *pMatrix;
+  TIndex N;                  // порядок матрицы
+  TIndex RowBegin, ColBegin; // левый верхний элемент блока в матрице
+  TIndex Rows, Cols;
+public:
+  TBlockView(ValType *p, TIndex n, TIndex rb, TIndex cb, TIndex rows, TIndex cols);
+  template <class OtherType>
+  TBlockView(const TBlockView<OtherType> &v)        // неконстантное -> константное
+    : pMatrix(v.GetMatrix()), N(v.GetOrder()), RowBegin(v.GetRowBegin()), ColBegin(v.GetColBegin()),
+      Rows(v.GetRows()), Cols(v.GetCols()) {}
+  ValType* GetMatrix() const { return pMatrix; }
+  TIndex GetOrder() const { return N; }
+  TIndex GetRowBegin() const { return RowBegin; }
+  TIndex GetColBegin() const { return ColBegin; }
+  TIndex GetRows() const { return Rows; }
+  TIndex GetCols() const { return Cols; }
+  ValType* Row(TIndex i) const { return pMatrix + PackedOffset(RowBegin + i, ColBegin, N); } // Cols элементов подряд
+  ValType& operator()(TIndex i, TIndex j) const { return Row(i)[j]; }                  // без проверки
+  TBlockView Block(TIndex rb, TIndex re, TIndex cb, TIndex ce) const; // строки [rb, re), столбцы [cb, ce)
+  TStridedView<ValType> Column(TIndex j) const;
+
+  template <class OtherType>
+  const TBlockView& CopyFrom(const TBlockView<OtherType> &v) const;
+  const TBlockView& operator+=(const TBlockView<const ElemType> &v) const;
+  const TBlockView& operator-=(const TBlockView<const ElemType> &v) const;
+  const TBlockView& operator*=(const ElemType &val) const;
+};
+
+template <class ValType>
+class TTriangleView
+{
+  typedef typename std::remove_const<ValType>::type ElemType;
+  ValType *pMatrix;
+  TIndex N;      // порядок матрицы
+  TIndex First;  // первая строка и первый столбец блока в матрице
+  TIndex Size;   // порядок блока
+public:
+  TTriangleView(ValType *p, TIndex n, TIndex first, TIndex size);
+  template <class OtherType>
+  TTriangleView(const TTriangleView<OtherType> &v)  // неконстантное -> константное
+    : pMatrix(v.GetMatrix()), N(v.GetOrder()), First(v.GetFirst()), Size(v.GetSize()) {}
+  ValType* GetMatrix() const { return pMatrix; }
+  TIndex GetOrder() const { return N; }
+  TIndex GetFirst() const { return First; }
+  TIndex GetSize() const { return Size; }
+  ValType* Row(TIndex i) const { return pMatrix + PackedOffset(First + i, First + i, N); } // (i, i) .. (i, Size - 1)
+  ValType& operator()(TIndex i, TIndex j) const { return Row(i)[j - i]; }              // без проверки, j >= i
+  TTriangleView Leading(TIndex k) const;                     // строки и столбцы [0, k)
+  TTriangleView Trailing(TIndex k) const;                    // строки и столбцы [k, Size)
+  TBlockView<ValType> Block(TIndex rb, TIndex re, TIndex cb, TIndex ce) const; // над диагональю: cb >= re - 1
+  TStridedView<ValType> Column(TIndex j) const;              // (0, j) .. (j, j)
+  TStridedView<ValType> Diagonal(TIndex d = 0) const;        // (i, i + d)
+
+  template <class OtherType>
+  const TTriangleView& CopyFrom(const TTriangleView<OtherType> &v) const;
+  const TTriangleView& operator+=(const TTriangleView<const ElemType> &v) const;
+  const TTriangleView& operator-=(const TTriangleView<const ElemType> &v) const;
+  const TTriangleView& operator*=(const ElemType &val) const;
+};
+
+template <class ValType> // умножить на скаляр
+const TStridedView<ValType>& TStridedView<ValType>::operator*=(const ElemType &val) const
+{
+	ForEach([&](TIndex, ValType &x) { x *= val; });
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // копирование элементов
+template <class OtherType>
+const TStridedView<ValType>& TStridedView<ValType>::CopyFrom(const TStridedView<OtherType> &v) const
+{
+	if (Size != v.GetSize())
+	{
+		throw std::runtime_error("Can't copy view with different size");
+	}
+	ForEach([&](TIndex k, ValType &x) { x = v[k]; });
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+TBlockView<ValType>::TBlockView(ValType *p, TIndex n, TIndex rb, TIndex cb, TIndex rows, TIndex cols)
+	: pMatrix(p), N(n), RowBegin(rb), ColBegin(cb), Rows(rows), Cols(cols)
+{
+	// все элементы блока должны лежать на диагонали или над ней
+	if (rows <= 0 || cols <= 0 || rb < 0 || cb + cols > n || cb < rb + rows - 1)
+	{
+		throw std::runtime_error("Invalid bounds for block view");
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // подблок
+TBlockView<ValType> TBlockView<ValType>::Block(TIndex rb, TIndex re, TIndex cb, TIndex ce) const
+{
+	if (rb < 0 || re > Rows || cb < 0 || ce > Cols)
+	{
+		throw std::runtime_error("Invalid bounds for block view");
+	}
+	return TBlockView(pMatrix, N, RowBegin + rb, ColBegin + cb, re - rb, ce - cb);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // столбец блока
+TStridedView<ValType> TBlockView<ValType>::Column(TIndex j) const
+{
+	if (j < 0 || j >= Cols)
+	{
+		throw std::runtime_error("Invalid index for column view");
+	}
+	return TStridedView<ValType>(Row(0) + j, Rows, N - RowBegin - 1);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // копирование элементов
+template <class OtherType>
+const TBlockView<ValType>& TBlockView<ValType>::CopyFrom(const TBlockView<OtherType> &v) const
+{
+	if (Rows != v.GetRows() || Cols != v.GetCols())
+	{
+		throw std::runtime_error("Can't copy view with different size");
+	}
+	for (TIndex i = 0; i < Rows; ++i)
+	{
+		std::copy(v.Row(i), v.Row(i) + Cols, Row(i));
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // прибавить блок
+const TBlockView<ValType>& TBlockView<ValType>::operator+=(const TBlockView<const ElemType> &v) const
+{
+	if (Rows != v.GetRows() || Cols != v.GetCols())
+	{
+		throw std::runtime_error("Can't add view with different size");
+	}
+	for (TIndex i = 0; i < Rows; ++i)
+	{
+		VecAdd(Row(i), Row(i), v.Row(i), Cols);
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // вычесть блок
+const TBlockView<ValType>& TBlockView<ValType>::operator-=(const TBlockView<const ElemType> &v) const
+{
+	if (Rows != v.GetRows() || Cols != v.GetCols())
+	{
+		throw std::runtime_error("Can't substract view with different size");
+	}
+	for (TIndex i = 0; i < Rows; ++i)
+	{
+		VecSub(Row(i), Row(i), v.Row(i), Cols);
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // умножить на скаляр
+const TBlockView<ValType>& TBlockView<ValType>::operator*=(const ElemType &val) const
+{
+	for (TIndex i = 0; i < Rows; ++i)
+	{
+		VecMulScalar(Row(i), Row(i), val, Cols);
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType>
+TTriangleView<ValType>::TTriangleView(ValType *p, TIndex n, TIndex first, TIndex size)
+	: pMatrix(p), N(n), First(first), Size(size)
+{
+	if (size <= 0 || first < 0 || first + size > n)
+	{
+		throw std::runtime_error("Invalid bounds for triangle view");
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // ведущий треугольник
+TTriangleView<ValType> TTriangleView<ValType>::Leading(TIndex k) const
+{
+	return TTriangleView(pMatrix, N, First, k <= Size ? k : 0);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // замыкающий треугольник
+TTriangleView<ValType> TTriangleView<ValType>::Trailing(TIndex k) const
+{
+	return TTriangleView(pMatrix, N, First + k, k >= 0 ? Size - k : 0);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // прямоугольный блок
+TBlockView<ValType> TTriangleView<ValType>::Block(TIndex rb, TIndex re, TIndex cb, TIndex ce) const
+{
+	if (rb < 0 || ce > Size)
+	{
+		throw std::runtime_error("Invalid bounds for block view");
+	}
+	return TBlockView<ValType>(pMatrix, N, First + rb, First + cb, re - rb, ce - cb);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // хранимая часть столбца
+TStridedView<ValType> TTriangleView<ValType>::Column(TIndex j) const
+{
+	if (j < 0 || j >= Size)
+	{
+		throw std::runtime_error("Invalid index for column view");
+	}
+	return TStridedView<ValType>(Row(0) + j, j + 1, N - First - 1);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // диагональ d (0 - главная)
+TStridedView<ValType> TTriangleView<ValType>::Diagonal(TIndex d) const
+{
+	if (d < 0 || d >= Size)
+	{
+		throw std::runtime_error("Invalid index for diagonal view");
+	}
+	return TStridedView<ValType>(Row(0) + d, Size - d, N - First);
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // копирование элементов
+template <class OtherType>
+const TTriangleView<ValType>& TTriangleView<ValType>::CopyFrom(const TTriangleView<OtherType> &v) const
+{
+	if (Size != v.GetSize())
+	{
+		throw std::runtime_error("Can't copy view with different size");
+	}
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		std::copy(v.Row(i), v.Row(i) + Size - i, Row(i));
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // прибавить треугольник
+const TTriangleView<ValType>& TTriangleView<ValType>::operator+=(const TTriangleView<const ElemType> &v) const
+{
+	if (Size != v.GetSize())
+	{
+		throw std::runtime_error("Can't add view with different size");
+	}
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		VecAdd(Row(i), Row(i), v.Row(i), Size - i);
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // вычесть треугольник
+const TTriangleView<ValType>& TTriangleView<ValType>::operator-=(const TTriangleView<const ElemType> &v) const
+{
+	if (Size != v.GetSize())
+	{
+		throw std::runtime_error("Can't substract view with different size");
+	}
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		VecSub(Row(i), Row(i), v.Row(i), Size - i);
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType> // умножить на скаляр
+const TTriangleView<ValType>& TTriangleView<ValType>::operator*=(const ElemType &val) const
+{
+	for (TIndex i = 0; i < Size; ++i)
+	{
+		VecMulScalar(Row(i), Row(i), val, Size - i);
+	}
+	return *this;
+} /*-------------------------------------------------------------------------*/
+
+template <class ValType, class OtherType> // сравнение
+bool operator==(const TTriangleView<ValType> &v1, const TTriangleView<OtherType> &v2)
+{
+	if (v1.GetSize() != v2.GetSize())
+	{
+		return false;
+	}
+	for (TIndex i = 0; i < v1.GetSize(); ++i)
+	{
+		if (!std::equal(v1.Row(i), v1.Row(i) + v1.GetSize() - i, v2.Row(i)))
+		{
+			return false;
+		}
+	}
+	return true;
+} /*-------------------------------------------------------------------------*/
+
+// Блочные алгоритмы. C += A * B для всех сочетаний треугольников и блоков;
+// размеры согласуются как при умножении матриц, элементы T - тип
+// неконстантного результата
+
+template <class T, class AType, class BType> // блок += блок * блок
+void MultiplyAdd(const TBlockView<T> &c, const TBlockView<AType> &a, const TBlockView<BType> &b)
+{
+	const TIndex m = c.GetRows(), n = c.GetCols(), p = a.GetCols();
+	if (a.GetRows() != m || b.GetRows() != p || b.GetCols() != n)
+	{
+		throw std::runtime_error("Can't multiply views with different size");
+	}
+	TIndex i = 0;
+	// по четыре строки C: каждая загруженная строка B используется четырежды
+	for (; i + 4 <= m; i += 4)
+	{
+		T *const aRows[4] = { c.Row(i), c.Row(i + 1), c.Row(i + 2), c.Row(i + 3) };
+		for (TIndex k = 0; k < p; ++k)
+		{
+			const T aAlpha[4] = { a(i, k), a(i + 1, k), a(i + 2, k), a(i + 3, k) };
+			VecAxpy4(aRows, aAlpha, b.Row(k), n);
+		}
+	}
+	for (; i < m; ++i)
+	{
+		for (TIndex k = 0; k < p; ++k)
+		{
+			VecAxpy(c.Row(i), (T)a(i, k), b.Row(k), n);
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class T, class AType, class BType> // блок += треугольник * блок
+void MultiplyAdd(const TBlockView<T> &c, const TTriangleView<AType> &a, const TBlockView<BType> &b)
+{
+	const TIndex m = c.GetRows(), n = c.GetCols();
+	if (a.GetSize() != m || b.GetRows() != m || b.GetCols() != n)
+	{
+		throw std::runtime_error("Can't multiply views with different size");
+	}
+	for (TIndex i = 0; i < m; ++i)
+	{
+		const AType *pA = a.Row(i);
+		for (TIndex k = i; k < m; ++k)
+		{
+			VecAxpy(c.Row(i), (T)pA[k - i], b.Row(k), n);
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class T, class AType, class BType> // блок += блок * треугольник
+void MultiplyAdd(const TBlockView<T> &c, const TBlockView<AType> &a, const TTriangleView<BType> &b)
+{
+	const TIndex m = c.GetRows(), n = c.GetCols();
+	if (a.GetRows() != m || a.GetCols() != n || b.GetSize() != n)
+	{
+		throw std::runtime_error("Can't multiply views with different size");
+	}
+	for (TIndex i = 0; i < m; ++i)
+	{
+		const AType *pA = a.Row(i);
+		T *pC = c.Row(i);
+		for (TIndex k = 0; k < n; ++k)
+		{
+			VecAxpy(pC + k, (T)pA[k], b.Row(k), n - k);
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class T, class AType, class BType> // треугольник += треугольник * треугольник
+void MultiplyAdd(const TTriangleView<T> &c, const TTriangleView<AType> &a, const TTriangleView<BType> &b)
+{
+	const TIndex n = c.GetSize();
+	if (a.GetSize() != n || b.GetSize() != n)
+	{
+		throw std::runtime_error("Can't multiply views with different size");
+	}
+	if (n <= VIEW_RECURSION_THRESHOLD)
+	{
+		for (TIndex i = 0; i < n; ++i)
+		{
+			const AType *pA = a.Row(i);
+			T *pC = c.Row(i);
+			for (TIndex k = i; k < n; ++k)
+			{
+				VecAxpy(pC + k - i, (T)pA[k - i], b.Row(k), n - k);
+			}
+		}
+		return;
+	}
+	// [C11 C12; 0 C22] += [A11 A12; 0 A22] * [B11 B12; 0 B22]
+	const TIndex h = n / 2;
+	MultiplyAdd(c.Leading(h), a.Leading(h), b.Leading(h));
+	MultiplyAdd(c.Block(0, h, h, n), a.Leading(h), b.Block(0, h, h, n));
+	MultiplyAdd(c.Block(0, h, h, n), a.Block(0, h, h, n), b.Trailing(h));
+	MultiplyAdd(c.Trailing(h), a.Trailing(h), b.Trailing(h));
+} /*-------------------------------------------------------------------------*/
+
+template <class AType> // есть нулевой диагональный элемент
+bool HasZeroPivot(const TTriangleView<AType> &a)
+{
+	for (TIndex i = 0; i < a.GetSize(); ++i)
+	{
+		if (a(i, i) == AType())
+		{
+			return true;
+		}
+	}
+	return false;
+} /*-------------------------------------------------------------------------*/
+
+template <class T, class AType> // рекурсия SolveInPlace; диагональ уже проверена
+void SolveInPlaceRecursive(const TTriangleView<AType> &a, T *x)
+{
+	const TIndex n = a.GetSize();
+	if (n <= VIEW_RECURSION_THRESHOLD)
+	{
+		for (TIndex i = n - 1; i >= 0; --i)
+		{
+			const AType *pA = a.Row(i);
+			x[i] = (x[i] - VecDot(pA + 1, (const T*)x + i + 1, n - i - 1)) / pA[0];
+		}
+		return;
+	}
+	// x2 = A22^-1 b2, затем x1 = A11^-1 (b1 - A12 x2)
+	const TIndex h = n / 2;
+	SolveInPlaceRecursive(a.Trailing(h), x + h);
+	const TBlockView<AType> a12 = a.Block(0, h, h, n);
+	for (TIndex i = 0; i < h; ++i)
+	{
+		x[i] -= VecDot(a12.Row(i), (const T*)x + h, n - h);
+	}
+	SolveInPlaceRecursive(a.Leading(h), x);
+} /*-------------------------------------------------------------------------*/
+
+template <class T, class AType> // A x = b, решение на месте правой части x
+void SolveInPlace(const TTriangleView<AType> &a, T *x)
+{
+	if (HasZeroPivot(a))
+	{
+		throw std::runtime_error("Can't solve system with zero pivot");
+	}
+	SolveInPlaceRecursive(a, x);
+} /*-------------------------------------------------------------------------*/
+
+template <class T, class AType> // B := A * B, A - треугольник
+void MultiplyLeftInPlace(const TBlockView<T> &b, const TTriangleView<AType> &a)
+{
+	const TIndex m = b.GetRows(), n = b.GetCols();
+	// строка i результата использует строки k >= i, еще не измененные
+	for (TIndex i = 0; i < m; ++i)
+	{
+		const AType *pA = a.Row(i);
+		T *pB = b.Row(i);
+		VecMulScalar(pB, (const T*)pB, (T)pA[0], n);
+		for (TIndex k = i + 1; k < m; ++k)
+		{
+			VecAxpy(pB, (T)pA[k - i], (const T*)b.Row(k), n);
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class T, class AType> // B := B * A, A - треугольник
+void MultiplyRightInPlace(const TBlockView<T> &b, const TTriangleView<AType> &a)
+{
+	const TIndex m = b.GetRows(), n = b.GetCols();
+	// элемент (i, j) результата использует элементы (i, k <= j): столбцы справа налево
+	for (TIndex i = 0; i < m; ++i)
+	{
+		T *pB = b.Row(i);
+		for (TIndex k = n - 1; k >= 0; --k)
+		{
+			const T bik = pB[k];
+			const AType *pA = a.Row(k);
+			pB[k] = bik * pA[0];
+			VecAxpy(pB + k + 1, bik, pA + 1, n - k - 1);
+		}
+	}
+} /*-------------------------------------------------------------------------*/
+
+template <class T> // рекурсия InvertInPlace; диагональ уже проверена
+void InvertInPlaceRecursive(const TTriangleView<T> &a)
+{
+	const TIndex n = a.GetSize();
+	if (n <= VIEW_RECURSION_THRESHOLD)
+	{
+		// строки снизу вверх: строка i обратной выражается через строки ниже
+		for (TIndex i = n - 1; i >= 0; --i)
+		{
+			T *pA = a.Row(i);
+			pA[0] = T(1) / pA[0];
+			// строка i: (i, j) = -a(i, i)^-1 * sum_{k=i+1..j} a(i, k) inv(k, j)
+			for (TIndex j = n - 1; j > i; --j)
+			{
+				T sum = T();
+				for (TIndex k = i + 1; k <= j; ++k)
+				{
+					sum += pA[k - i] * a(k, j);
+				}
+				pA[j - i] = -pA[0] * sum;
+			}
+		}
+		return;
+	}
+	// [A11 A12; 0 A22]^-1 = [A11^-1, -A11^-1 A12 A22^-1; 0, A22^-1]
+	const TIndex h = n / 2;
+	const TTriangleView<T> a11 = a.Leading(h), a22 = a.Trailing(h);
+	InvertInPlaceRecursive(a11);
+	InvertInPlaceRecursive(a22);
+	const TBlockView<T> a12 = a.Block(0, h, h, n);
+	MultiplyLeftInPlace(a12, TTriangleView<const T>(a11));
+	MultiplyRightInPlace(a12, TTriangleView<const T>(a22));
+	a12 *= T(-1);
+} /*-------------------------------------------------------------------------*/
+
+template <class T> // A := A^-1
+void InvertInPlace(const TTriangleView<T> &a)
+{
+	if (HasZeroPivot(a))
+	{
+		throw std::runtime_error("Can't invert matrix with zero pivot");
+	}
+	InvertInPlaceRecursive(a);
+} /*-------------------------------------------------------------------------*/
+
+#endif
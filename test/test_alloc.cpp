@@ -0,0 +1,238 @@
+#include "utmatrix.h"
+
+#include <gtest.h>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+	template <class Type>
+	bool IsAligned(const Type *p, size_t theAlignment)
+	{
+		return reinterpret_cast<uintptr_t>(p) % theAlignment == 0;
+	}
+
+	// Counts allocations and keeps the count in a shared object, so that
+	// copies of the allocator report into the same counter.
+	template <class Type>
+	class TCountingAllocator
+	{
+	public:
+		typedef Type value_type;
+
+		explicit TCountingAllocator(int &theCount) : pCount(&theCount) {}
+		template <class OtherType>
+		TCountingAllocator(const TCountingAllocator<OtherType> &a) : pCount(a.pCount) {}
+		Type* allocate(size_t n) { ++*pCount; return std::allocator<Type>().allocate(n); }
+		void deallocate(Type *p, size_t n) { --*pCount; std::allocator<Type>().deallocate(p, n); }
+		bool operator==(const TCountingAllocator &a) const { return pCount == a.pCount; }
+		bool operator!=(const TCountingAllocator &a) const { return pCount != a.pCount; }
+
+		int *pCount;
+	};
+
+	struct alignas(64) TWideElement
+	{
+		double Values[2];
+	};
+}
+
+TEST(TAlloc, aligned_allocator_returns_aligned_blocks)
+{
+	TAlignedAllocator<double> a;
+	for (size_t n = 1; n < 100; n += 7)
+	{
+		double *p = a.allocate(n);
+		EXPECT_TRUE(IsAligned(p, STORAGE_ALIGNMENT));
+		a.deallocate(p, n);
+	}
+}
+
+TEST(TAlloc, aligned_allocator_can_return_zeroed_block)
+{
+	TAlignedAllocator<int, 128> a;
+	int *p = a.allocate_zeroed(1000);
+	EXPECT_TRUE(IsAligned(p, 128));
+	EXPECT_EQ(0, std::accumulate(p, p + 1000, 0));
+	a.deallocate(p, 1000);
+}
+
+TEST(TAlloc, matrix_buffer_is_aligned_by_default)
+{
+	TMatrix<double> m(17);
+	EXPECT_TRUE(IsAligned(&m[0][0], STORAGE_ALIGNMENT));
+}
+
+TEST(TAlloc, arena_allocations_do_not_overlap)
+{
+	TArena arena(256);
+	TArenaAllocator<int> a(arena);
+	int *p1 = a.allocate(10), *p2 = a.allocate(10), *p3 = a.allocate(100);
+	std::fill(p1, p1 + 10, 1);
+	std::fill(p2, p2 + 10, 2);
+	std::fill(p3, p3 + 100, 3);
+	EXPECT_EQ(10, std::accumulate(p1, p1 + 10, 0));
+	EXPECT_EQ(20, std::accumulate(p2, p2 + 10, 0));
+	EXPECT_EQ(300, std::accumulate(p3, p3 + 100, 0));
+	EXPECT_EQ(120 * sizeof(int), arena.GetUsed());
+}
+
+TEST(TAlloc, arena_reset_reuses_memory)
+{
+	TArena arena(1024);
+	TArenaAllocator<double> a(arena);
+	double *p1 = a.allocate(16);
+	arena.Reset();
+	EXPECT_EQ(0u, arena.GetUsed());
+	double *p2 = a.allocate(16);
+	EXPECT_EQ(p1, p2);
+}
+
+TEST(TAlloc, pool_reuses_freed_blocks)
+{
+	TPool pool;
+	TPoolAllocator<double> a(pool);
+	double *p1 = a.allocate(5);
+	a.deallocate(p1, 5);
+	double *p2 = a.allocate(6);
+	EXPECT_EQ(p1, p2);
+	a.deallocate(p2, 6);
+}
+
+TEST(TAlloc, pool_serves_large_blocks)
+{
+	TPool pool;
+	TPoolAllocator<double> a(pool);
+	double *p = a.allocate(10000);
+	std::fill(p, p + 10000, 1.0);
+	EXPECT_DOUBLE_EQ(10000.0, std::accumulate(p, p + 10000, 0.0));
+	a.deallocate(p, 10000);
+}
+
+TEST(TAlloc, pool_aligns_over_aligned_types)
+{
+	TPool pool;
+	TPoolAllocator<TWideElement> a(pool);
+	const size_t aCounts[] = { 1, 2, 3, 63, 64, 65 };
+	std::vector<TWideElement*> aBlocks;
+	for (size_t c : aCounts)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			aBlocks.push_back(a.allocate(c));
+			EXPECT_TRUE(IsAligned(aBlocks.back(), alignof(TWideElement)));
+		}
+	}
+	size_t b = 0;
+	for (size_t c : aCounts)
+	{
+		for (int k = 0; k < 3; k++)
+			a.deallocate(aBlocks[b++], c);
+	}
+}
+
+TEST(TAlloc, vector_uses_given_allocator)
+{
+	int count = 0;
+	{
+		TCountingAllocator<int> a(count);
+		TVector<int, TCountingAllocator<int> > v1(5, 0, a);
+		EXPECT_EQ(1, count);
+		TVector<int, TCountingAllocator<int> > v2(v1);
+		EXPECT_EQ(2, count);
+		v1 = v1 + v2;
+		EXPECT_EQ(2, count);
+	}
+	EXPECT_EQ(0, count);
+}
+
+TEST(TAlloc, can_use_vectors_from_arena)
+{
+	TArena arena;
+	TArenaAllocator<double> a(arena);
+	typedef TVector<double, TArenaAllocator<double> > TArenaVector;
+	TArenaVector v1(8, 0, a), v2(8, 0, a);
+	std::fill(v1.begin(), v1.end(), 1.0);
+	std::fill(v2.begin(), v2.end(), 2.0);
+	TArenaVector v3(v1 + v2 * 2.0, a);
+	EXPECT_DOUBLE_EQ(5.0, v3[7]);
+	EXPECT_DOUBLE_EQ(16.0, v1 * v2);
+}
+
+TEST(TAlloc, can_use_matrices_from_pool)
+{
+	TPool pool;
+	TPoolAllocator<double> a(pool);
+	typedef TMatrix<double, TPoolAllocator<double> > TPoolMatrix;
+	TPoolMatrix m1(6, INIT_ZERO, a), m2(6, INIT_ZERO, a);
+	for (int i = 0; i < 6; ++i)
+	{
+		m1[i][i] = 2.0;
+		m2[i][5] = 1.0;
+	}
+	TPoolMatrix m3 = m1 * m2;
+	EXPECT_DOUBLE_EQ(2.0, m3[0][5]);
+	EXPECT_DOUBLE_EQ(0.0, m3[0][4]);
+	TPoolMatrix m4(m1 + m3, a);
+	EXPECT_DOUBLE_EQ(4.0, m4[5][5]);
+
+	TVector<double> x(6);
+	std::fill(x.begin(), x.end(), 1.0);
+	Solve(m1, x);
+	EXPECT_DOUBLE_EQ(0.5, x[3]);
+	EXPECT_DOUBLE_EQ(2.0, (m1 * x)[0] + (x * m1)[1]);
+}
+
+TEST(TAlloc, zero_filled_matrix_from_arena_is_zero)
+{
+	TArena arena;
+	TMatrix<int, TArenaAllocator<int> > m(20, INIT_ZERO, TArenaAllocator<int>(arena));
+	for (int i = 0; i < 20; ++i)
+	{
+		EXPECT_EQ(0, std::accumulate(m[i].begin(), m[i].end(), 0));
+	}
+}
+
+TEST(TAlloc, huge_page_block_is_aligned_and_zeroed)
+{
+	TAlignedAllocator<double> a(PAGES_HUGE);
+	const size_t n = 2 * HUGE_PAGE_SIZE / sizeof(double) + 3;
+	double *p = a.allocate_zeroed(n);
+	EXPECT_TRUE(IsAligned(p, STORAGE_ALIGNMENT));
+	EXPECT_DOUBLE_EQ(0.0, std::accumulate(p, p + n, 0.0));
+	p[n - 1] = 1.0;
+	a.deallocate(p, n);
+}
+
+TEST(TAlloc, small_block_with_huge_page_policy_comes_from_malloc)
+{
+	TAlignedAllocator<int> a(PAGES_HUGE);
+	int *p = a.allocate(10);
+	EXPECT_TRUE(IsAligned(p, STORAGE_ALIGNMENT));
+	std::fill(p, p + 10, 1);
+	TAlignedAllocator<int>().deallocate(p, 10);
+}
+
+TEST(TAlloc, can_select_huge_pages_per_matrix)
+{
+	const int size = 1100;
+	TMatrix<double> m1(size, INIT_ZERO, PAGES_HUGE), m2(size, INIT_ZERO);
+	EXPECT_EQ(PAGES_HUGE, m1.GetAllocator().GetPagePolicy());
+	EXPECT_EQ(PAGES_DEFAULT, m2.GetAllocator().GetPagePolicy());
+	EXPECT_EQ(m1, m2);
+	m1[3][1000] = 2.0;
+	m2 = m1 + m1;
+	EXPECT_DOUBLE_EQ(4.0, m2[3][1000]);
+}
+
+TEST(TAlloc, first_touch_matrix_is_zero_filled)
+{
+	const int size = 1100;
+	SetThreadCount(4);
+	TMatrix<double> m(size, INIT_UNINITIALIZED, PAGES_HUGE_FIRST_TOUCH);
+	SetThreadCount(1);
+	for (int i = 0; i < size; i += 99)
+	{
+		ASSERT_DOUBLE_EQ(0.0, std::accumulate(m[i].begin(), m[i].end(), 0.0));
+	}
+}
@@ -0,0 +1,135 @@
+#include "utmatrix.h"
+#include "test_helpers.h"
+
+#include <gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+TEST(TBinary, header_is_64_bytes_long)
+{
+	EXPECT_EQ(64u, sizeof(TBinaryHeader));
+}
+
+TEST(TBinary, element_types_are_distinguished)
+{
+	EXPECT_EQ(TYPE_FLOAT, BinaryTypeOf<double>());
+	EXPECT_EQ(TYPE_SIGNED, BinaryTypeOf<int>());
+	EXPECT_EQ(TYPE_UNSIGNED, BinaryTypeOf<unsigned>());
+	EXPECT_EQ(TYPE_BOOL, BinaryTypeOf<bool>());
+}
+
+TEST(TBinary, checksum_depends_on_order_of_words)
+{
+	const uint64_t a[2] = { 1, 2 };
+	const uint64_t b[2] = { 2, 1 };
+
+	EXPECT_NE(BinaryChecksum(a, sizeof(a)), BinaryChecksum(b, sizeof(b)));
+}
+
+TEST(TBinary, can_save_and_load_vector)
+{
+	TVector<int> v(5, 3);
+	for (int i = 3; i < 8; i++)
+		v[i] = i * i;
+	std::stringstream s;
+	v.SaveBinary(s);
+
+	EXPECT_EQ(v, TVector<int>::LoadBinary(s));
+}
+
+TEST(TBinary, saved_matrix_is_header_and_packed_elements)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	std::stringstream s;
+	m.SaveBinary(s);
+
+	EXPECT_EQ(sizeof(TBinaryHeader) + 55 * sizeof(double), s.str().size());
+}
+
+TEST(TBinary, can_save_and_load_matrix)
+{
+	TMatrix<double> m = CreateFilledMatrix(50);
+	std::stringstream s;
+	m.SaveBinary(s);
+	TMatrix<double> m1 = TMatrix<double>::LoadBinary(s);
+
+	EXPECT_EQ(m, m1);
+}
+
+TEST(TBinary, throws_when_load_matrix_with_other_element_type)
+{
+	TMatrix<double> m = CreateFilledMatrix(5);
+	std::stringstream s;
+	m.SaveBinary(s);
+
+	ASSERT_ANY_THROW(TMatrix<float>::LoadBinary(s));
+}
+
+TEST(TBinary, throws_when_load_vector_as_matrix)
+{
+	TVector<double> v(6);
+	std::stringstream s;
+	v.SaveBinary(s);
+
+	ASSERT_ANY_THROW(TMatrix<double>::LoadBinary(s));
+}
+
+TEST(TBinary, throws_when_load_corrupted_data)
+{
+	TMatrix<double> m = CreateFilledMatrix(5);
+	std::stringstream s;
+	m.SaveBinary(s);
+	std::string data = s.str();
+	data[data.size() - 1] ^= 1;
+	std::stringstream corrupted(data);
+
+	ASSERT_ANY_THROW(TMatrix<double>::LoadBinary(corrupted));
+}
+
+TEST(TBinary, throws_when_load_truncated_data)
+{
+	TMatrix<double> m = CreateFilledMatrix(5);
+	std::stringstream s;
+	m.SaveBinary(s);
+	std::stringstream truncated(s.str().substr(0, s.str().size() - 8));
+
+	ASSERT_ANY_THROW(TMatrix<double>::LoadBinary(truncated));
+}
+
+TEST(TBinary, throws_when_load_text)
+{
+	std::stringstream s("1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30");
+
+	ASSERT_ANY_THROW(TMatrix<int>::LoadBinary(s));
+}
+
+TEST(TBinary, can_map_saved_matrix)
+{
+	TTempFile file("test_binary_map.bin");
+	TMatrix<double> m = CreateFilledMatrix(100);
+	{
+		std::ofstream out(file.Path.c_str(), std::ios::binary);
+		m.SaveBinary(out);
+	}
+	TMatrix<double> m1 = TMatrix<double>::MapBinary(file.Path, true);
+
+	EXPECT_TRUE(m1.IsMapped());
+	EXPECT_EQ(m, m1);
+}
+
+TEST(TBinary, changes_of_mapped_binary_matrix_are_not_written)
+{
+	TTempFile file("test_binary_private.bin");
+	{
+		std::ofstream out(file.Path.c_str(), std::ios::binary);
+		CreateFilledMatrix(10).SaveBinary(out);
+	}
+	{
+		TMatrix<double> m = TMatrix<double>::MapBinary(file.Path);
+		m[1][2] = -1;
+	}
+	std::ifstream in(file.Path.c_str(), std::ios::binary);
+
+	EXPECT_EQ(CreateFilledMatrix(10), TMatrix<double>::LoadBinary(in));
+}
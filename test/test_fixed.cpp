@@ -0,0 +1,240 @@
+#include "utmatrix.h"
+#include "test_helpers.h"
+
+#include <gtest.h>
+#include <cmath>
+#include <sstream>
+#include <type_traits>
+
+namespace
+{
+	TVector<double> CreateFilledVector(int theSize)
+	{
+		TVector<double> v(theSize);
+		for (int i = 0; i < theSize; i++)
+			v[i] = i % 4 - 1.5;
+		return v;
+	}
+
+	// Uses only the interface shared by TMatrix and TFixedMatrix.
+	template <class MatrixType>
+	typename MatrixType::ValueType SumOfDiagonal(const MatrixType &m)
+	{
+		typename MatrixType::ValueType aSum = 0;
+		for (TIndex i = 0; i < m.GetSize(); i++)
+			aSum += m[i][i];
+		return aSum;
+	}
+
+	template <class MatrixType>
+	MatrixType SquarePlusSelf(const MatrixType &m)
+	{
+		MatrixType aResult = m * m;
+		aResult += m;
+		return aResult;
+	}
+}
+
+TEST(TFixedMatrix, stores_elements_inside_object)
+{
+	static_assert(sizeof(TFixedMatrix<double, 4>) == 10 * sizeof(double), "fixed matrix has extra fields");
+	static_assert(TFixedMatrix<double, 4>::GetSize() == 4, "order is not a constant");
+	static_assert(TFixedMatrix<double, 4>::Offset(1, 1) == 4, "offset is not a constant");
+	static_assert(TFixedMatrix<double, 4>::Offset(3, 3) == 9, "offset is not a constant");
+	SUCCEED();
+}
+
+TEST(TFixedMatrix, throws_when_create_matrix_with_wrong_size)
+{
+	ASSERT_ANY_THROW((TFixedMatrix<double, 3>(4)));
+}
+
+TEST(TFixedMatrix, can_create_zero_matrix)
+{
+	TFixedMatrix<double, 5> m(5, INIT_ZERO);
+	for (int i = 0; i < 5; i++)
+		for (int j = i; j < 5; j++)
+			EXPECT_EQ(0, m[i][j]);
+}
+
+TEST(TFixedMatrix, empty_braces_give_zero_matrix)
+{
+	TFixedMatrix<double, 4> m = {};
+	for (int i = 0; i < 4; i++)
+		for (int j = i; j < 4; j++)
+			EXPECT_EQ(0, m[i][j]);
+}
+
+TEST(TFixedMatrix, size_constructor_is_explicit)
+{
+	typedef TFixedMatrix<double, 4> TFixed;
+
+	EXPECT_FALSE((std::is_convertible<TIndex, TFixed>::value));
+}
+
+TEST(TFixedMatrix, can_set_and_get_element)
+{
+	typedef TFixedMatrix<int, 4> TFixed;
+	TFixed m(4, INIT_ZERO);
+	m[1][3] = 7;
+
+	EXPECT_EQ(7, m[1][3]);
+	EXPECT_EQ(7, m.UncheckedAt(1, 3));
+	EXPECT_EQ(7, m.data()[TFixed::Offset(1, 3)]);
+}
+
+TEST(TFixedMatrix, throws_when_index_is_out_of_range)
+{
+	TFixedMatrix<int, 4> m(4, INIT_ZERO);
+
+	ASSERT_ANY_THROW(m[4]);
+	ASSERT_ANY_THROW(m[-1]);
+	ASSERT_ANY_THROW(m[2][1] = 1);
+}
+
+TEST(TFixedMatrix, can_convert_from_and_to_matrix)
+{
+	typedef TFixedMatrix<double, 6> TFixed;
+	const TMatrix<double> m = CreateFilledMatrix<TFixed>(TFixed::GetSize()).ToMatrix();
+	const TFixed f(m);
+
+	EXPECT_EQ(CreateFilledMatrix<TFixed>(TFixed::GetSize()), f);
+	EXPECT_EQ(m, f.ToMatrix());
+}
+
+TEST(TFixedMatrix, throws_when_convert_matrix_with_different_size)
+{
+	const TMatrix<double> m(5);
+
+	ASSERT_ANY_THROW((TFixedMatrix<double, 6>(m)));
+}
+
+TEST(TFixedMatrix, compare_equal_and_not_equal_matrices)
+{
+	const TFixedMatrix<double, 3> m1 = CreateFilledMatrix<TFixedMatrix<double, 3> >(3);
+	TFixedMatrix<double, 3> m2(m1);
+
+	EXPECT_TRUE(m1 == m2);
+	m2[0][2] += 1;
+	EXPECT_TRUE(m1 != m2);
+}
+
+TEST(TFixedMatrix, elementwise_operations_match_matrix)
+{
+	typedef TFixedMatrix<double, 7> TFixed;
+	const TFixed a = CreateFilledMatrix<TFixed>(TFixed::GetSize(), 1), b = CreateFilledMatrix<TFixed>(TFixed::GetSize(), 4);
+	const TMatrix<double> ma = a.ToMatrix(), mb = b.ToMatrix();
+	TFixed axpy(a);
+	axpy.Axpy(2.0, b);
+	TMatrix<double> maxpy(ma);
+	maxpy.Axpy(2.0, mb);
+	TFixed divided(a);
+	divided /= 4.0;
+
+	EXPECT_EQ(TMatrix<double>(ma + mb), (a + b).ToMatrix());
+	EXPECT_EQ(TMatrix<double>(ma - mb), (a - b).ToMatrix());
+	EXPECT_EQ(TMatrix<double>(ma * 3.0), (a * 3.0).ToMatrix());
+	EXPECT_EQ(maxpy, axpy.ToMatrix());
+	EXPECT_EQ(TMatrix<double>(ma * 0.25), divided.ToMatrix());
+}
+
+TEST(TFixedMatrix, multiplication_matches_matrix)
+{
+	typedef TFixedMatrix<double, 16> TFixed;
+	const TFixed a = CreateFilledMatrix<TFixed>(TFixed::GetSize(), 2), b = CreateFilledMatrix<TFixed>(TFixed::GetSize(), 5);
+
+	EXPECT_EQ(a.ToMatrix() * b.ToMatrix(), (a * b).ToMatrix());
+}
+
+TEST(TFixedMatrix, multiplication_of_order_one_matrices)
+{
+	TFixedMatrix<int, 1> a, b;
+	a[0][0] = 3;
+	b[0][0] = -4;
+
+	EXPECT_EQ(-12, (a * b)[0][0]);
+}
+
+TEST(TFixedMatrix, multiplication_by_vector_matches_matrix)
+{
+	typedef TFixedMatrix<double, 9> TFixed;
+	const TFixed a = CreateFilledMatrix<TFixed>(TFixed::GetSize(), 3);
+	const TVector<double> x = CreateFilledVector(9);
+
+	EXPECT_EQ(a.ToMatrix() * x, a * x);
+	EXPECT_EQ(x * a.ToMatrix(), x * a);
+}
+
+TEST(TFixedMatrix, throws_when_multiply_by_vector_with_different_size)
+{
+	const TFixedMatrix<double, 4> a(4, INIT_ZERO);
+	const TVector<double> x(5);
+
+	ASSERT_ANY_THROW(a * x);
+	ASSERT_ANY_THROW(x * a);
+}
+
+TEST(TFixedMatrix, solve_matches_matrix)
+{
+	typedef TFixedMatrix<double, 12> TFixed;
+	const TFixed a = CreateFilledMatrix<TFixed>(TFixed::GetSize(), 1);
+	TVector<double> x = CreateFilledVector(12), y(x);
+	Solve(a, x);
+	Solve(a.ToMatrix(), y);
+
+	for (int i = 0; i < 12; i++)
+		EXPECT_NEAR(y[i], x[i], 1e-12);
+}
+
+TEST(TFixedMatrix, solution_satisfies_system)
+{
+	typedef TFixedMatrix<double, 5> TFixed;
+	const TFixed a = CreateFilledMatrix<TFixed>(TFixed::GetSize());
+	const TVector<double> b = CreateFilledVector(5);
+	TVector<double> x(b);
+	Solve(a, x);
+	const TVector<double> ax = a * x;
+
+	for (int i = 0; i < 5; i++)
+		EXPECT_NEAR(b[i], ax[i], 1e-12);
+}
+
+TEST(TFixedMatrix, throws_when_solve_with_zero_pivot)
+{
+	TFixedMatrix<double, 3> a = CreateFilledMatrix<TFixedMatrix<double, 3> >(3);
+	a[1][1] = 0;
+	TVector<double> x(3);
+
+	ASSERT_ANY_THROW(Solve(a, x));
+}
+
+TEST(TFixedMatrix, generic_code_works_with_both_matrices)
+{
+	typedef TFixedMatrix<double, 8> TFixed;
+	const TFixed f = CreateFilledMatrix<TFixed>(TFixed::GetSize(), 2);
+	const TMatrix<double> m = f.ToMatrix();
+
+	EXPECT_EQ(SumOfDiagonal(m), SumOfDiagonal(f));
+	EXPECT_EQ(SquarePlusSelf(m), SquarePlusSelf(f).ToMatrix());
+}
+
+TEST(TFixedMatrix, output_matches_matrix)
+{
+	const TFixedMatrix<int, 4> f = CreateFilledMatrix<TFixedMatrix<int, 4> >(4);
+	std::ostringstream out1, out2;
+	out1 << f;
+	out2 << f.ToMatrix();
+
+	EXPECT_EQ(out2.str(), out1.str());
+}
+
+TEST(TFixedMatrix, can_read_matrix)
+{
+	std::istringstream in("1 2 3\n4 5\n6\n");
+	TFixedMatrix<int, 3> m;
+	in >> m;
+
+	EXPECT_EQ(2, m[0][1]);
+	EXPECT_EQ(5, m[1][2]);
+	EXPECT_EQ(6, m[2][2]);
+}
@@ -0,0 +1,57 @@
+// Fixtures shared by the tests.
+
+#ifndef __TEST_HELPERS_H__
+#define __TEST_HELPERS_H__
+
+#include "utmatrix.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// Removes the file when the test finishes, even if it fails. The second
+// constructor creates the file with the given text.
+class TTempFile
+{
+public:
+	explicit TTempFile(const char *theName) : Path(theName) { std::remove(Path.c_str()); }
+	TTempFile(const char *theName, const std::string &theText) : Path(theName)
+	{
+		std::ofstream out(Path.c_str(), std::ios::binary);
+		out << theText;
+	}
+	~TTempFile() { std::remove(Path.c_str()); }
+
+	std::string Path;
+};
+
+// Sets the global thread count for the lifetime of the object and
+// returns to sequential execution afterwards.
+class TThreadCountGuard
+{
+public:
+	explicit TThreadCountGuard(int theCount) { SetThreadCount(theCount); }
+	~TThreadCountGuard() { SetThreadCount(1); }
+};
+
+// Element (i, j) becomes (i * 100 + j) * theScale + theShift; the
+// fractional default shift makes text and binary round trips exact only
+// when all digits are kept. Works with TMatrix and TFixedMatrix.
+template <class MatrixType>
+void FillMatrix(MatrixType &m, double theScale = 1, double theShift = 0.25)
+{
+	typedef typename MatrixType::ValueType ValueType;
+	for (TIndex i = 0; i < m.GetSize(); i++)
+		for (TIndex j = i; j < m.GetSize(); j++)
+			m[i][j] = (ValueType)((i * 100 + j) * theScale + theShift);
+}
+
+template <class MatrixType = TMatrix<double> >
+MatrixType CreateFilledMatrix(TIndex theSize, double theScale = 1, double theShift = 0.25)
+{
+	MatrixType m(theSize);
+	FillMatrix(m, theScale, theShift);
+	return m;
+}
+
+#endif
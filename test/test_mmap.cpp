@@ -0,0 +1,146 @@
+#include "utmatrix.h"
+#include "test_helpers.h"
+
+#include <gtest.h>
+#include <cstdio>
+#include <fstream>
+
+TEST(TMatrixMapped, can_create_mapped_matrix)
+{
+	TTempFile file("test_mmap_create.bin");
+	TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 5);
+
+	EXPECT_TRUE(m.IsMapped());
+	EXPECT_EQ(5, m.GetSize());
+}
+
+TEST(TMatrixMapped, mapped_file_keeps_written_elements)
+{
+	TTempFile file("test_mmap_keep.bin");
+	TMatrix<double> expected(20);
+	FillMatrix(expected);
+	{
+		TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 20);
+		FillMatrix(m);
+		m.Sync();
+	}
+	TMatrix<double> m = TMatrix<double>::MapFile(file.Path);
+
+	EXPECT_EQ(20, m.GetSize());
+	EXPECT_EQ(expected, m);
+}
+
+TEST(TMatrixMapped, can_add_mapped_matrices)
+{
+	TTempFile file("test_mmap_add.bin");
+	{
+		TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 10);
+		FillMatrix(m);
+	}
+	TMatrix<double> m = TMatrix<double>::MapFile(file.Path);
+	TMatrix<double> expected(10);
+	FillMatrix(expected);
+
+	TMatrix<double> sum = m + m;
+
+	EXPECT_EQ(TMatrix<double>(expected + expected), sum);
+	EXPECT_FALSE(sum.IsMapped());
+}
+
+TEST(TMatrixMapped, copy_of_mapped_matrix_is_in_memory)
+{
+	TTempFile file("test_mmap_copy.bin");
+	TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 10);
+	FillMatrix(m);
+	TMatrix<double> copy(m);
+	copy[0][0] = -1;
+
+	EXPECT_FALSE(copy.IsMapped());
+	EXPECT_EQ(0.25, m[0][0]);
+}
+
+TEST(TMatrixMapped, changes_of_read_only_mapping_are_not_written)
+{
+	TTempFile file("test_mmap_read_only.bin");
+	{
+		TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 10);
+		FillMatrix(m);
+	}
+	{
+		TMatrix<double> m = TMatrix<double>::MapFile(file.Path, MAP_READ_ONLY);
+		m[2][3] = -1;
+		EXPECT_EQ(-1, m[2][3]);
+	}
+	TMatrix<double> m = TMatrix<double>::MapFile(file.Path);
+
+	EXPECT_EQ(203.25, m[2][3]);
+}
+
+TEST(TMatrixMapped, changes_of_read_write_mapping_are_written)
+{
+	TTempFile file("test_mmap_read_write.bin");
+	{
+		TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 10);
+		FillMatrix(m);
+	}
+	{
+		TMatrix<double> m = TMatrix<double>::MapFile(file.Path, MAP_READ_WRITE);
+		m[2][3] = -1;
+	}
+	TMatrix<double> m = TMatrix<double>::MapFile(file.Path);
+
+	EXPECT_EQ(-1, m[2][3]);
+}
+
+TEST(TMatrixMapped, assign_to_mapped_matrix_of_other_size_releases_mapping)
+{
+	TTempFile file("test_mmap_assign.bin");
+	TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 10);
+	TMatrix<double> m1(3);
+	FillMatrix(m1);
+	m = m1;
+
+	EXPECT_FALSE(m.IsMapped());
+	EXPECT_EQ(m1, m);
+}
+
+TEST(TMatrixMapped, assign_copy_on_write_matrix_writes_to_file)
+{
+	TTempFile file("test_mmap_assign_shared.bin");
+	{
+		TMatrix<double> m = TMatrix<double>::CreateMappedFile(file.Path, 10);
+		TMatrix<double> aSource = CreateFilledMatrix(10);
+		aSource.SetCopyOnWrite(true);
+		m = aSource;
+
+		EXPECT_TRUE(m.IsMapped());
+		m.Sync();
+	}
+	TMatrix<double> m = TMatrix<double>::MapFile(file.Path);
+
+	EXPECT_EQ(CreateFilledMatrix(10), m);
+}
+
+TEST(TMatrixMapped, throws_when_map_missing_file)
+{
+	ASSERT_ANY_THROW(TMatrix<double>::MapFile("test_mmap_missing.bin"));
+}
+
+TEST(TMatrixMapped, throws_when_file_size_is_not_packed_matrix)
+{
+	TTempFile file("test_mmap_bad_size.bin");
+	{
+		std::ofstream out(file.Path.c_str(), std::ios::binary);
+		const double a[4] = {1, 2, 3, 4};
+		out.write(reinterpret_cast<const char*>(a), sizeof(a));
+	}
+
+	ASSERT_ANY_THROW(TMatrix<double>::MapFile(file.Path));
+}
+
+TEST(TMatrixMapped, throws_when_create_mapped_matrix_with_negative_length)
+{
+	TTempFile file("test_mmap_negative.bin");
+
+	ASSERT_ANY_THROW(TMatrix<double>::CreateMappedFile(file.Path, -5));
+}
@@ -0,0 +1,149 @@
+#include "utmatrix.h"
+
+#include <gtest.h>
+
+namespace
+{
+	// Runs theCheck for every SIMD level supported by the current processor,
+	// restoring the detected level afterwards.
+	template <class Functor>
+	void ForEachSimdLevel(Functor theCheck)
+	{
+		for (int level = SIMD_SCALAR; level <= DetectSimdLevel(); ++level)
+		{
+			SetSimdLevel(static_cast<TSimdLevel>(level));
+			theCheck();
+		}
+		SetSimdLevel(DetectSimdLevel());
+	}
+
+	// Sizes cover empty input, pure tails and several full unrolled blocks.
+	const int Sizes[] = { 0, 1, 3, 7, 16, 33, 67, 130 };
+
+	template <class Type>
+	void FillVectors(Type *pA, Type *pB, int theSize)
+	{
+		for (int i = 0; i < theSize; ++i)
+		{
+			pA[i] = static_cast<Type>(i % 13 - 6);
+			pB[i] = static_cast<Type>(3 * (i % 7) + 1);
+		}
+	}
+
+	template <class Type>
+	void CheckKernelsAgainstScalar()
+	{
+		for (int size : Sizes)
+		{
+			Type a[130], b[130], expected[130], actual[130];
+			FillVectors(a, b, size);
+
+			ScalarAdd(expected, a, b, size);
+			VecAdd(actual, a, b, size);
+			ASSERT_TRUE(std::equal(expected, expected + size, actual));
+
+			ScalarSub(expected, a, b, size);
+			VecSub(actual, a, b, size);
+			ASSERT_TRUE(std::equal(expected, expected + size, actual));
+
+			ScalarAddScalar(expected, a, Type(5), size);
+			VecAddScalar(actual, a, Type(5), size);
+			ASSERT_TRUE(std::equal(expected, expected + size, actual));
+
+			ScalarSubScalar(expected, a, Type(5), size);
+			VecSubScalar(actual, a, Type(5), size);
+			ASSERT_TRUE(std::equal(expected, expected + size, actual));
+
+			ScalarMulScalar(expected, a, Type(-3), size);
+			VecMulScalar(actual, a, Type(-3), size);
+			ASSERT_TRUE(std::equal(expected, expected + size, actual));
+
+			std::copy(b, b + size, expected);
+			std::copy(b, b + size, actual);
+			ScalarAxpy(expected, Type(2), a, size);
+			VecAxpy(actual, Type(2), a, size);
+			ASSERT_TRUE(std::equal(expected, expected + size, actual));
+
+			Type rows[4][130], rowsExpected[4][130];
+			const Type alpha[4] = { Type(1), Type(-2), Type(3), Type(0) };
+			for (int r = 0; r < 4; ++r)
+			{
+				std::copy(b, b + size, rows[r]);
+				std::copy(b, b + size, rowsExpected[r]);
+			}
+			Type *const pRows[4] = { rows[0], rows[1], rows[2], rows[3] };
+			Type *const pRowsExpected[4] = { rowsExpected[0], rowsExpected[1], rowsExpected[2], rowsExpected[3] };
+			ScalarAxpy4(pRowsExpected, alpha, a, size);
+			VecAxpy4(pRows, alpha, a, size);
+			for (int r = 0; r < 4; ++r)
+			{
+				ASSERT_TRUE(std::equal(rowsExpected[r], rowsExpected[r] + size, rows[r]));
+			}
+
+			ASSERT_EQ(ScalarDot(a, b, size), VecDot(a, b, size));
+		}
+	}
+}
+
+TEST(TSimd, detected_level_is_current_by_default)
+{
+	EXPECT_EQ(DetectSimdLevel(), GetSimdLevel());
+}
+
+TEST(TSimd, cant_select_level_above_detected)
+{
+	SetSimdLevel(SIMD_AVX512);
+	EXPECT_EQ(DetectSimdLevel(), GetSimdLevel());
+}
+
+TEST(TSimd, float_kernels_match_scalar_loops)
+{
+	ForEachSimdLevel(CheckKernelsAgainstScalar<float>);
+}
+
+TEST(TSimd, double_kernels_match_scalar_loops)
+{
+	ForEachSimdLevel(CheckKernelsAgainstScalar<double>);
+}
+
+TEST(TSimd, int32_kernels_match_scalar_loops)
+{
+	ForEachSimdLevel(CheckKernelsAgainstScalar<std::int32_t>);
+}
+
+TEST(TSimd, int64_kernels_match_scalar_loops)
+{
+	ForEachSimdLevel(CheckKernelsAgainstScalar<std::int64_t>);
+}
+
+TEST(TSimd, int64_multiplication_keeps_high_bits)
+{
+	ForEachSimdLevel([]()
+	{
+		std::int64_t a[9], expected[9], actual[9];
+		for (int i = 0; i < 9; ++i)
+		{
+			a[i] = (std::int64_t(1) << 33) + i - 4;
+		}
+		ScalarMulScalar(expected, a, std::int64_t(-(std::int64_t(1) << 20) - 3), 9);
+		VecMulScalar(actual, a, std::int64_t(-(std::int64_t(1) << 20) - 3), 9);
+		ASSERT_TRUE(std::equal(expected, expected + 9, actual));
+	});
+}
+
+TEST(TSimd, vector_operations_use_kernels_for_double)
+{
+	ForEachSimdLevel([]()
+	{
+		TVector<double> a(21), b(21);
+		for (int i = 0; i < 21; ++i)
+		{
+			a[i] = i * 0.5;
+			b[i] = 2.0;
+		}
+		TVector<double> c = a + b;
+		c -= b * 2.0;
+		EXPECT_DOUBLE_EQ(a[20] - 2.0, c[20]);
+		EXPECT_DOUBLE_EQ(2.0 * (0.5 * 20 * 21 / 2), a * b);
+	});
+}
@@ -0,0 +1,173 @@
+#include "utmatrix.h"
+#include "test_helpers.h"
+
+#include <gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	void SaveMatrix(const TMatrix<double> &m, const std::string &thePath)
+	{
+		std::ofstream out(thePath.c_str(), std::ios::binary);
+		m.SaveBinary(out);
+	}
+
+	void WriteSize(const std::string &thePath, int64_t theSize)
+	{
+		std::fstream f(thePath.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		f.seekp(offsetof(TBinaryHeader, Size));
+		f.write(reinterpret_cast<const char*>(&theSize), sizeof(theSize));
+	}
+
+	TMatrix<double> LoadMatrix(const std::string &thePath)
+	{
+		std::ifstream in(thePath.c_str(), std::ios::binary);
+		return TMatrix<double>::LoadBinary(in);
+	}
+}
+
+TEST(TStream, block_holds_at_least_one_row)
+{
+	EXPECT_EQ(1, StreamBlockEnd(0, 100, 10));
+	EXPECT_EQ(100, StreamBlockEnd(99, 100, 10));
+}
+
+TEST(TStream, block_is_limited_by_element_count)
+{
+	// rows 0, 1, 2 of order 10 hold 10 + 9 + 8 elements
+	EXPECT_EQ(3, StreamBlockEnd(0, 10, 27));
+	EXPECT_EQ(2, StreamBlockEnd(0, 10, 26));
+}
+
+TEST(TStream, can_read_matrix_by_blocks)
+{
+	TTempFile file("test_stream_read.bin");
+	TMatrix<double> m = CreateFilledMatrix(50, 1);
+	SaveMatrix(m, file.Path);
+	TRowStreamReader<double> reader(file.Path, 100 * sizeof(double));
+	int64_t row = 0;
+	int blocks = 0;
+	bool equal = true;
+	while (reader.NextBlock())
+	{
+		EXPECT_EQ(row, reader.GetRow());
+		const double *p = reader.GetData();
+		for (int i = (int)reader.GetRow(); i < reader.GetRowEnd(); i++)
+			for (int j = i; j < 50; j++)
+				equal = equal && *p++ == m[i][j];
+		row = reader.GetRowEnd();
+		blocks++;
+	}
+
+	EXPECT_TRUE(equal);
+	EXPECT_EQ(50, row);
+	EXPECT_LT(10, blocks);
+}
+
+TEST(TStream, written_rows_can_be_loaded)
+{
+	TTempFile file("test_stream_write.bin");
+	TMatrix<double> m = CreateFilledMatrix(3, 1);
+	const double aRows[6] = { 0.25, 1.25, 2.25, 101.25, 102.25, 202.25 };
+	TRowStreamWriter<double> writer(file.Path, 3);
+	writer.Write(aRows, 3);
+	writer.Write(aRows + 3, 3);
+	writer.Close();
+
+	EXPECT_EQ(m, LoadMatrix(file.Path));
+}
+
+TEST(TStream, throws_when_close_before_all_rows_are_written)
+{
+	TTempFile file("test_stream_short.bin");
+	const double aRows[3] = { 0, 1, 2 };
+	TRowStreamWriter<double> writer(file.Path, 3);
+	writer.Write(aRows, 3);
+
+	ASSERT_ANY_THROW(writer.Close());
+}
+
+TEST(TStream, can_add_matrices_in_files)
+{
+	TTempFile fileA("test_stream_a.bin"), fileB("test_stream_b.bin"), fileC("test_stream_c.bin");
+	TMatrix<double> a = CreateFilledMatrix(200, 1), b = CreateFilledMatrix(200, 0.5);
+	SaveMatrix(a, fileA.Path);
+	SaveMatrix(b, fileB.Path);
+	StreamAdd<double>(fileA.Path, fileB.Path, fileC.Path, 4096);
+
+	EXPECT_EQ(TMatrix<double>(a + b), LoadMatrix(fileC.Path));
+}
+
+TEST(TStream, can_subtract_matrices_in_files)
+{
+	TTempFile fileA("test_stream_sa.bin"), fileB("test_stream_sb.bin"), fileC("test_stream_sc.bin");
+	TMatrix<double> a = CreateFilledMatrix(100, 1), b = CreateFilledMatrix(100, 0.5);
+	SaveMatrix(a, fileA.Path);
+	SaveMatrix(b, fileB.Path);
+	StreamSub<double>(fileA.Path, fileB.Path, fileC.Path);
+
+	EXPECT_EQ(TMatrix<double>(a - b), LoadMatrix(fileC.Path));
+}
+
+TEST(TStream, throws_when_process_matrices_with_different_size)
+{
+	TTempFile fileA("test_stream_da.bin"), fileB("test_stream_db.bin"), fileC("test_stream_dc.bin");
+	SaveMatrix(CreateFilledMatrix(10, 1), fileA.Path);
+	SaveMatrix(CreateFilledMatrix(11, 1), fileB.Path);
+
+	ASSERT_ANY_THROW(StreamAdd<double>(fileA.Path, fileB.Path, fileC.Path));
+}
+
+TEST(TStream, throws_when_stream_corrupted_file)
+{
+	TTempFile fileA("test_stream_ca.bin"), fileB("test_stream_cb.bin"), fileC("test_stream_cc.bin");
+	SaveMatrix(CreateFilledMatrix(10, 1), fileA.Path);
+	SaveMatrix(CreateFilledMatrix(10, 1), fileB.Path);
+	{
+		std::fstream f(fileB.Path.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		f.seekp(sizeof(TBinaryHeader) + 8);
+		f.put('x');
+	}
+
+	ASSERT_ANY_THROW(StreamAdd<double>(fileA.Path, fileB.Path, fileC.Path, 64));
+}
+
+TEST(TStream, throws_when_read_file_with_too_large_order)
+{
+	TTempFile file("test_stream_large.bin");
+	SaveMatrix(CreateFilledMatrix(10), file.Path);
+	WriteSize(file.Path, (int64_t)1 << 62);
+
+	ASSERT_ANY_THROW(TRowStreamReader<double> reader(file.Path));
+	WriteSize(file.Path, MAX_MATRIX_SIZE);
+	ASSERT_ANY_THROW(TRowStreamReader<double> reader(file.Path));
+}
+
+TEST(TStream, throws_when_read_file_with_extra_bytes)
+{
+	TTempFile file("test_stream_extra.bin");
+	SaveMatrix(CreateFilledMatrix(10), file.Path);
+	{
+		std::ofstream out(file.Path.c_str(), std::ios::binary | std::ios::app);
+		out.put('x');
+	}
+
+	ASSERT_ANY_THROW(TRowStreamReader<double> reader(file.Path));
+}
+
+TEST(TStream, throws_when_read_truncated_file)
+{
+	TTempFile file("test_stream_short_file.bin");
+	std::ostringstream out;
+	CreateFilledMatrix(10).SaveBinary(out);
+	const std::string data = out.str();
+	{
+		std::ofstream f(file.Path.c_str(), std::ios::binary);
+		f.write(data.data(), (std::streamsize)data.size() - (std::streamsize)sizeof(double));
+	}
+
+	ASSERT_ANY_THROW(TRowStreamReader<double> reader(file.Path));
+}
@@ -0,0 +1,272 @@
+#include "utmatrix.h"
+#include "test_helpers.h"
+
+#include <gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+TEST(TText, stream_output_of_matrix_keeps_layout)
+{
+	TMatrix<int> m(3);
+	for (int i = 0; i < 3; i++)
+		for (int j = i; j < 3; j++)
+			m[i][j] = i * 3 + j;
+	std::ostringstream out;
+	out << m;
+
+	EXPECT_EQ("0\t1\t2\t\n\t4\t5\t\n\t\t8\t\n", out.str());
+}
+
+TEST(TText, text_output_of_matrix_matches_stream_output)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	std::ostringstream out, text;
+	out << m;
+	m.WriteText(text);
+
+	EXPECT_EQ(out.str(), text.str());
+}
+
+TEST(TText, text_output_of_vector_matches_stream_output)
+{
+	TVector<int> v(4, 2);
+	for (int i = 2; i < 6; i++)
+		v[i] = -i * 1000;
+	std::ostringstream out, text;
+	out << v;
+	v.WriteText(text);
+
+	EXPECT_EQ(out.str(), text.str());
+}
+
+TEST(TText, can_write_full_matrix)
+{
+	TMatrix<int> m(2);
+	m[0][0] = 1;
+	m[0][1] = 2;
+	m[1][1] = 3;
+	std::ostringstream text;
+	m.WriteText(text, TEXT_FULL);
+
+	EXPECT_EQ("1\t2\t\n0\t3\t\n", text.str());
+}
+
+TEST(TText, can_read_written_matrix)
+{
+	TMatrix<double> m = CreateFilledMatrix(20);
+	std::stringstream text;
+	m.WriteText(text);
+	TMatrix<double> m1(20);
+	m1.ReadText(text);
+
+	EXPECT_EQ(m, m1);
+}
+
+TEST(TText, can_read_full_matrix)
+{
+	TMatrix<double> m = CreateFilledMatrix(20);
+	std::stringstream text;
+	m.WriteText(text, TEXT_FULL);
+	TMatrix<double> m1(20);
+	m1.ReadText(text, TEXT_FULL);
+
+	EXPECT_EQ(m, m1);
+}
+
+TEST(TText, written_doubles_are_read_back_exactly)
+{
+	TVector<double> v(3);
+	v[0] = 0.1;
+	v[1] = 1.0 / 3;
+	v[2] = -1e-300;
+	std::stringstream text;
+	v.WriteText(text);
+	TVector<double> v1(3);
+	v1.ReadText(text);
+
+	EXPECT_EQ(v, v1);
+}
+
+TEST(TText, reader_leaves_rest_of_stream)
+{
+	std::istringstream in("1 2 3 rest");
+	TVector<int> v(3);
+	v.ReadText(in);
+	std::string rest;
+	in >> rest;
+
+	EXPECT_EQ(3, v[2]);
+	EXPECT_EQ("rest", rest);
+}
+
+TEST(TText, throws_when_read_invalid_number)
+{
+	std::istringstream in("1 2x 3");
+	TVector<int> v(3);
+
+	ASSERT_ANY_THROW(v.ReadText(in));
+}
+
+TEST(TText, throws_when_text_ends_early)
+{
+	std::istringstream in("1 2");
+	TVector<int> v(3);
+
+	ASSERT_ANY_THROW(v.ReadText(in));
+}
+
+TEST(TText, parse_error_is_reported_when_stream_throws_on_failure)
+{
+	std::istringstream in("1 2x 3");
+	in.exceptions(std::ios::failbit | std::ios::badbit);
+	TVector<int> v(3);
+
+	// std::ios_base::failure is a std::runtime_error too, so it is caught first
+	try
+	{
+		v.ReadText(in);
+		FAIL() << "no exception";
+	}
+	catch (const std::ios_base::failure&)
+	{
+		FAIL() << "stream failure hides parse error";
+	}
+	catch (const std::runtime_error &e)
+	{
+		EXPECT_STREQ("Can't parse number", e.what());
+	}
+}
+
+TEST(TText, parse_error_sets_failbit)
+{
+	std::istringstream in("1 2x 3");
+	TVector<int> v(3);
+
+	ASSERT_ANY_THROW(v.ReadText(in));
+	EXPECT_TRUE(in.fail());
+}
+
+TEST(TText, can_read_numbers_with_plus_sign)
+{
+	std::istringstream in("+1 -2 +3.5");
+	TVector<double> v(3);
+
+	v.ReadText(in);
+
+	EXPECT_EQ(1, v[0]);
+	EXPECT_EQ(-2, v[1]);
+	EXPECT_EQ(3.5, v[2]);
+}
+
+TEST(TText, throws_when_read_number_with_two_signs)
+{
+	std::istringstream in("+-1");
+	TVector<int> v(1);
+
+	ASSERT_ANY_THROW(v.ReadText(in));
+}
+
+TEST(TText, throws_when_read_full_matrix_with_nonzero_lower_part)
+{
+	std::istringstream in("1 2\n5 3\n");
+	TMatrix<int> m(2);
+
+	ASSERT_ANY_THROW(m.ReadText(in, TEXT_FULL));
+}
+
+TEST(TText, writer_passes_text_in_blocks)
+{
+	std::ostringstream out;
+	{
+		TTextWriter writer(out, 256);
+		for (int i = 0; i < 1000; i++)
+		{
+			writer.Write(i);
+			writer.Put(' ');
+		}
+	}
+	std::istringstream in(out.str());
+	TTextReader reader(in);
+	int last = 0;
+	for (int i = 0; i < 1000; i++)
+		reader.Read(last);
+
+	EXPECT_EQ(999, last);
+}
+
+namespace
+{
+	std::string ErrorMessage(TMatrix<int> &m, const std::string &thePath)
+	{
+		try
+		{
+			m.ReadTextFile(thePath);
+		}
+		catch (const std::exception &e)
+		{
+			return e.what();
+		}
+		return "";
+	}
+}
+
+TEST(TText, can_read_text_file)
+{
+	TMatrix<double> m = CreateFilledMatrix(30);
+	std::ostringstream text;
+	m.WriteText(text);
+	TTempFile file("test_text_read.txt", text.str());
+	TMatrix<double> m1(30);
+	m1.ReadTextFile(file.Path);
+
+	EXPECT_EQ(m, m1);
+}
+
+TEST(TText, can_read_full_text_file_without_last_newline)
+{
+	TTempFile file("test_text_full.txt", "1 2 3\r\n0 4 5\r\n0 0 6");
+	TMatrix<int> m(3);
+	m.ReadTextFile(file.Path, TEXT_FULL);
+
+	EXPECT_EQ(1, m[0][0]);
+	EXPECT_EQ(5, m[1][2]);
+	EXPECT_EQ(6, m[2][2]);
+}
+
+TEST(TText, can_read_large_text_file_in_parallel)
+{
+	TThreadCountGuard guard(4);
+	TMatrix<double> m = CreateFilledMatrix(400);
+	std::ostringstream text;
+	m.WriteText(text);
+	TTempFile file("test_text_parallel.txt", text.str() + "\n\n");
+	TMatrix<double> m1(400);
+	m1.ReadTextFile(file.Path);
+
+	EXPECT_EQ(m, m1);
+}
+
+TEST(TText, text_file_error_reports_row_and_column)
+{
+	TTempFile file("test_text_error.txt", "1 2 3\n4 x\n6\n");
+	TMatrix<int> m(3);
+
+	EXPECT_NE(std::string::npos, ErrorMessage(m, file.Path).find("row 1, column 2"));
+}
+
+TEST(TText, throws_when_text_file_has_too_few_rows)
+{
+	TTempFile file("test_text_few.txt", "1 2 3\n4 5\n");
+	TMatrix<int> m(3);
+
+	EXPECT_NE(std::string::npos, ErrorMessage(m, file.Path).find("too few rows"));
+}
+
+TEST(TText, throws_when_text_file_row_is_too_long)
+{
+	TTempFile file("test_text_long.txt", "1 2 3\n4 5 7\n6\n");
+	TMatrix<int> m(3);
+
+	EXPECT_NE(std::string::npos, ErrorMessage(m, file.Path).find("extra element at row 1"));
+}
@@ -0,0 +1,222 @@
+#include "utmatrix.h"
+#include "test_helpers.h"
+
+#include <gtest.h>
+#include <atomic>
+#include <chrono>
+
+namespace
+{
+	// Order large enough to exceed PARALLEL_MIN_ELEMENTS.
+	const int ParallelSize = 400;
+}
+
+TEST(TThreadPool, runs_every_task_once)
+{
+	TThreadPool aPool(4);
+	std::atomic<int> aCounts[16];
+	for (int t = 0; t < 16; ++t)
+	{
+		aCounts[t] = 0;
+	}
+	aPool.Run(16, [&](int t) { ++aCounts[t]; });
+	for (int t = 0; t < 16; ++t)
+	{
+		EXPECT_EQ(1, aCounts[t]);
+	}
+}
+
+TEST(TThreadPool, can_be_reused)
+{
+	TThreadPool aPool(3);
+	std::atomic<int> aSum(0);
+	for (int r = 0; r < 50; ++r)
+	{
+		aPool.Run(3, [&](int t) { aSum += t + 1; });
+	}
+	EXPECT_EQ(300, aSum);
+}
+
+TEST(TThreadPool, back_to_back_runs_with_few_tasks_finish)
+{
+	// late workers must not take tasks of the next call
+	TThreadPool aPool(8);
+	std::atomic<int> aDone(0);
+	for (int r = 0; r < 5000; ++r)
+	{
+		aPool.Run(2, [&](int) { ++aDone; std::this_thread::yield(); });
+	}
+	EXPECT_EQ(10000, aDone.load());
+}
+
+TEST(TThreadPool, rethrows_task_exception_after_all_tasks_finish)
+{
+	TThreadPool aPool(4);
+	std::atomic<int> aFinished(0);
+	ASSERT_ANY_THROW(aPool.Run(8, [&](int t)
+	{
+		if (t == 2)
+		{
+			throw std::runtime_error("task failed");
+		}
+		++aFinished;
+	}));
+	EXPECT_EQ(7, aFinished);
+}
+
+TEST(TThreadPool, nested_run_executes_sequentially)
+{
+	TThreadPool aPool(2);
+	std::atomic<int> aSum(0);
+	aPool.Run(2, [&](int)
+	{
+		aPool.Run(3, [&](int t) { aSum += t; });
+	});
+	EXPECT_EQ(6, aSum);
+}
+
+TEST(TThreadPool, split_of_triangle_covers_all_rows)
+{
+	std::vector<TIndex> aBounds = SplitTriangleRows(100, 7);
+	ASSERT_EQ(8, (int)aBounds.size());
+	EXPECT_EQ(0, aBounds[0]);
+	EXPECT_EQ(100, aBounds[7]);
+	for (int t = 0; t < 7; ++t)
+	{
+		EXPECT_LE(aBounds[t], aBounds[t + 1]);
+	}
+}
+
+TEST(TThreadPool, split_of_triangle_has_equal_areas)
+{
+	const int n = 1000, parts = 8;
+	std::vector<TIndex> aBounds = SplitTriangleRows(n, parts);
+	const int area = n * (n + 1) / 2 / parts;
+	for (int t = 0; t < parts; ++t)
+	{
+		int elements = 0;
+		for (int i = aBounds[t]; i < aBounds[t + 1]; ++i)
+		{
+			elements += n - i;
+		}
+		// a band can differ from the ideal only by one row
+		EXPECT_NEAR(area, elements, n);
+	}
+	// equal numbers of rows would make the first band much heavier
+	EXPECT_LT(aBounds[1], n / parts);
+	EXPECT_GT(aBounds[parts] - aBounds[parts - 1], n / parts);
+}
+
+TEST(TThreadPool, parallel_matrix_operations_match_sequential)
+{
+	const TMatrix<double> a = CreateFilledMatrix(ParallelSize, 1.5), b = CreateFilledMatrix(ParallelSize, -0.5);
+	TMatrix<double> sum = a + b, diff = a - b, scaled = a * 3.0;
+	TMatrix<double> axpy(a);
+	axpy.Axpy(2.0, b);
+
+	TThreadCountGuard aGuard(4);
+	EXPECT_EQ(4, GetThreadCount());
+	EXPECT_EQ(sum, TMatrix<double>(a + b));
+	EXPECT_EQ(diff, TMatrix<double>(a - b));
+	EXPECT_EQ(scaled, TMatrix<double>(a * 3.0));
+	TMatrix<double> c(a);
+	c.Axpy(2.0, b);
+	EXPECT_EQ(axpy, c);
+	c = a;
+	c += b;
+	EXPECT_EQ(sum, c);
+	c -= b;
+	c -= b;
+	EXPECT_EQ(diff, c);
+}
+
+TEST(TThreadPool, parallel_expression_matches_sequential)
+{
+	const TMatrix<double> a = CreateFilledMatrix(ParallelSize, 1.0), b = CreateFilledMatrix(ParallelSize, 2.0);
+	TMatrix<double> expected = a * 2.0 + b - a;
+
+	TThreadCountGuard aGuard(3);
+	TMatrix<double> c = a * 2.0 + b - a;
+	EXPECT_EQ(expected, c);
+}
+
+TEST(TThreadPool, parallel_size_check_throws_before_work)
+{
+	TThreadCountGuard aGuard(4);
+	TMatrix<double> a = CreateFilledMatrix(ParallelSize, 1.0), b(ParallelSize - 1);
+	ASSERT_ANY_THROW(a += b);
+}
+
+TEST(TThreadPool, pinned_task_runs_on_same_thread)
+{
+	TThreadPool aPool(4);
+	std::thread::id aFirst[8], aSecond[8];
+	aPool.RunPinned(8, [&](int t) { aFirst[t] = std::this_thread::get_id(); });
+	aPool.RunPinned(8, [&](int t) { aSecond[t] = std::this_thread::get_id(); });
+	for (int t = 0; t < 8; ++t)
+	{
+		EXPECT_EQ(aFirst[t], aSecond[t]);
+		EXPECT_EQ(aFirst[t % 4], aFirst[t]);
+	}
+	EXPECT_EQ(std::this_thread::get_id(), aFirst[0]);
+}
+
+TEST(TThreadPool, free_threads_take_remaining_tasks)
+{
+	TThreadPool aPool(4);
+	std::atomic<int> aDone(0);
+	bool aOthersFinished = false;
+	// task 0 waits for the rest; with fixed assignment task 4 would be
+	// queued behind it on the same thread
+	aPool.Run(8, [&](int t)
+	{
+		if (t == 0)
+		{
+			const auto aDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while (aDone < 7 && std::chrono::steady_clock::now() < aDeadline)
+				std::this_thread::yield();
+			aOthersFinished = aDone == 7;
+		}
+		else
+			++aDone;
+	});
+	EXPECT_TRUE(aOthersFinished);
+}
+
+TEST(TThreadPool, copy_on_write_snapshots_can_be_read_by_other_threads)
+{
+	TMatrix<double> aSource = CreateFilledMatrix(ParallelSize, 1.0);
+	aSource.SetCopyOnWrite(true);
+	const TMatrix<double> aExpected(CreateFilledMatrix(ParallelSize, 1.0));
+	std::vector<std::thread> aThreads;
+	std::atomic<int> aMatches(0);
+	for (int t = 0; t < 4; ++t)
+	{
+		const TMatrix<double> aSnapshot(aSource);
+		aThreads.push_back(std::thread([aSnapshot, &aExpected, &aMatches]()
+		{
+			TMatrix<double> aCopy(aSnapshot);
+			if (aCopy == aExpected)
+				++aMatches;
+		}));
+	}
+	aSource *= 2;
+	for (size_t t = 0; t < aThreads.size(); ++t)
+	{
+		aThreads[t].join();
+	}
+	EXPECT_EQ(4, aMatches.load());
+	EXPECT_EQ(TMatrix<double>(aExpected * 2.0), aSource);
+}
+
+TEST(TThreadPool, split_of_large_triangle_has_equal_areas)
+{
+	const TIndex n = 200000;
+	const int parts = 4;
+	std::vector<TIndex> aBounds = SplitTriangleRows(n, parts);
+	for (int t = 0; t < parts; ++t)
+	{
+		const TIndex elements = PackedRowOffset(aBounds[t + 1], n) - PackedRowOffset(aBounds[t], n);
+		EXPECT_NEAR((double)PackedCount(n) / parts, (double)elements, (double)n);
+	}
+}
@@ -1,6 +1,8 @@
 #include "utmatrix.h"
 
 #include <gtest.h>
+#include <numeric>
+#include <type_traits>
 
 namespace
 {
@@ -210,3 +212,694 @@ TEST(TMatrix, cant_subtract_matrixes_with_not_equal_size)
 	ASSERT_ANY_THROW(v - v1);
 }
 
+TEST(TMatrix, rows_are_stored_in_one_contiguous_buffer)
+{
+	const int size = 10;
+	TMatrix<int> m(size);
+	for (int i = 0; i + 1 < size; ++i)
+	{
+		ASSERT_EQ(&(m[i][size - 1]) + 1, &(m[i + 1][i + 1]));
+	}
+}
+
+TEST(TMatrix, row_has_size_and_start_index_of_upper_triangle)
+{
+	TMatrix<int> m(10);
+	EXPECT_EQ(7, m[3].GetSize());
+	EXPECT_EQ(3, m[3].GetStartIndex());
+}
+
+TEST(TMatrix, throws_when_access_element_below_diagonal)
+{
+	TMatrix<int> m(10);
+	ASSERT_ANY_THROW(m[3][2] = 5);
+}
+
+TEST(TMatrix, can_convert_row_to_vector)
+{
+	const int size = 10;
+	TMatrix<int> m = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TVector<int> v = m[4];
+	EXPECT_EQ(4, v.GetStartIndex());
+	EXPECT_EQ(m[4], v);
+}
+
+TEST(TMatrix, can_assign_vector_to_row_of_same_shape)
+{
+	TMatrix<int> m = CreateMatrix<int>(5, ConstantFunction<int>, 0);
+	TVector<int> v(3, 2);
+	v[2] = 1; v[3] = 2; v[4] = 3;
+	m[2] = v;
+	EXPECT_EQ(2, m[2][3]);
+	EXPECT_EQ(0, m[1][3]);
+}
+
+TEST(TMatrix, throws_when_assign_vector_of_different_shape_to_row)
+{
+	TMatrix<int> m(5);
+	ASSERT_ANY_THROW(m[2] = TVector<int>(3));
+}
+
+TEST(TMatrix, can_convert_vector_of_vectors_to_matrix)
+{
+	const int size = 4;
+	TVector<TVector<int> > vv(size);
+	for (int i = 0; i < size; ++i)
+	{
+		vv[i] = TVector<int>(size - i, i);
+		for (int j = i; j < size; ++j)
+		{
+			vv[i][j] = ElementsNumberFunction<int>(i, j, size);
+		}
+	}
+	TMatrix<int> m(vv);
+	ASSERT_EQ(CreateMatrix<int>(size, ElementsNumberFunction<int>, size), m);
+}
+
+TEST(TMatrix, move_constructor_takes_source_memory)
+{
+	TMatrix<int> m = CreateMatrix<int>(10, ElementsNumberFunction<int>, 10);
+	const int *pData = &(m[0][0]);
+	TMatrix<int> m1(std::move(m));
+	EXPECT_EQ(pData, &(m1[0][0]));
+	EXPECT_EQ(0, m.GetSize());
+}
+
+TEST(TMatrix, can_move_assign_matrix)
+{
+	TMatrix<int> m = CreateMatrix<int>(10, ElementsNumberFunction<int>, 10);
+	TMatrix<int> expected(m);
+	TMatrix<int> m1(5);
+	m1 = std::move(m);
+	ASSERT_EQ(expected, m1);
+}
+
+TEST(TMatrix, can_swap_matrices)
+{
+	TMatrix<int> m = CreateMatrix<int>(10, ElementsNumberFunction<int>, 10);
+	TMatrix<int> m1 = CreateMatrix<int>(5, ConstantFunction<int>, 5);
+	TMatrix<int> expected(m), expected1(m1);
+	swap(m, m1);
+	EXPECT_EQ(expected1, m);
+	EXPECT_EQ(expected, m1);
+}
+
+TEST(TMatrix, chained_operations_reuse_first_temporary)
+{
+	const int size = 10;
+	TMatrix<int> a = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TMatrix<int> b = CreateMatrix<int>(size, ConstantFunction<int>, 5);
+	TMatrix<int> tmp(a);
+	const int *pData = &(tmp[0][0]);
+
+	TMatrix<int> actual = std::move(tmp) + b - a;
+
+	EXPECT_EQ(pData, &(actual[0][0]));
+	EXPECT_EQ(b, actual);
+}
+
+TEST(TMatrix, can_evaluate_chained_expression)
+{
+	const int size = 10;
+	TMatrix<int> a = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TMatrix<int> b = CreateMatrix<int>(size, ConstantFunction<int>, 3);
+	TMatrix<int> c = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+
+	TMatrix<int> expected = CreateMatrix<int>(size,
+		[](int i, int j, int size) { return 3 - ElementsNumberFunction<int>(i, j, size); }, size);
+
+	TMatrix<int> actual = a + b - c * 2;
+	ASSERT_EQ(expected, actual);
+}
+
+TEST(TMatrix, can_assign_expression_with_matrix_as_operand)
+{
+	const int size = 10;
+	TMatrix<int> a = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TMatrix<int> b = CreateMatrix<int>(size, ConstantFunction<int>, 1);
+
+	TMatrix<int> expected = CreateMatrix<int>(size,
+		[](int i, int j, int size) { return ElementsNumberFunction<int>(i, j, size) + 1; }, size);
+
+	a = a + b;
+	ASSERT_EQ(expected, a);
+}
+
+TEST(TMatrix, throws_when_expression_operands_have_different_size)
+{
+	TMatrix<int> a(10), b(10), c(15);
+	ASSERT_ANY_THROW(a + b - c);
+}
+
+TEST(TMatrix, can_add_matrix_in_place_without_reallocation)
+{
+	const int size = 10;
+	TMatrix<int> m = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TMatrix<int> m1 = CreateMatrix<int>(size, ConstantFunction<int>, 5);
+	const int *pData = &(m[0][0]);
+
+	TMatrix<int> expected = CreateMatrix<int>(size,
+		[](int i, int j, int size) { return ElementsNumberFunction<int>(i, j, size) + 5; }, size);
+
+	m += m1;
+
+	EXPECT_EQ(pData, &(m[0][0]));
+	EXPECT_EQ(expected, m);
+}
+
+TEST(TMatrix, cant_subtract_matrix_of_different_size_in_place)
+{
+	TMatrix<int> m(10);
+	TMatrix<int> m1(15);
+	ASSERT_ANY_THROW(m -= m1);
+}
+
+TEST(TMatrix, can_multiply_and_divide_by_scalar_in_place)
+{
+	const int size = 10;
+	TMatrix<int> m = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+
+	TMatrix<int> expected = CreateMatrix<int>(size,
+		[](int i, int j, int size) { return 3 * ElementsNumberFunction<int>(i, j, size); }, size);
+
+	m *= 6;
+	m /= 2;
+	ASSERT_EQ(expected, m);
+}
+
+TEST(TMatrix, can_do_axpy)
+{
+	const int size = 10;
+	TMatrix<int> y = CreateMatrix<int>(size, ConstantFunction<int>, 1);
+	TMatrix<int> x = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+
+	TMatrix<int> expected = CreateMatrix<int>(size,
+		[](int i, int j, int size) { return 1 + 2 * ElementsNumberFunction<int>(i, j, size); }, size);
+
+	y.Axpy(2, x);
+	ASSERT_EQ(expected, y);
+}
+
+namespace
+{
+	// Straightforward C(i, j) = sum A(i, k) * B(k, j), i <= k <= j.
+	template <class Type>
+	TMatrix<Type> MultiplyByDefinition(const TMatrix<Type> &a, const TMatrix<Type> &b)
+	{
+		const int size = a.GetSize();
+		TMatrix<Type> aResult(size);
+		for (int i = 0; i < size; ++i)
+		{
+			for (int j = i; j < size; ++j)
+			{
+				Type sum = 0;
+				for (int k = i; k <= j; ++k)
+				{
+					sum += a[i][k] * b[k][j];
+				}
+				aResult[i][j] = sum;
+			}
+		}
+		return aResult;
+	}
+}
+
+TEST(TMatrix, can_multiply_small_matrices)
+{
+	const int size = 3;
+	TMatrix<int> a = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TMatrix<int> b = CreateMatrix<int>(size, ConstantFunction<int>, 1);
+	TMatrix<int> expected(size);
+	expected[0][0] = 0; expected[0][1] = 1; expected[0][2] = 3;
+	expected[1][1] = 4; expected[1][2] = 9;
+	expected[2][2] = 8;
+
+	ASSERT_EQ(expected, a * b);
+}
+
+TEST(TMatrix, product_with_identity_is_the_same_matrix)
+{
+	const int size = 70;
+	TMatrix<int> a = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TMatrix<int> identity = CreateMatrix<int>(size, [](int i, int j) { return i == j ? 1 : 0; });
+
+	EXPECT_EQ(a, a * identity);
+	EXPECT_EQ(a, identity * a);
+}
+
+TEST(TMatrix, blocked_product_matches_definition)
+{
+	// the order is not a multiple of the block size, so edge blocks are partial
+	const int size = 2 * TRMM_BLOCK_SIZE + 7;
+	TMatrix<int> a = CreateMatrix<int>(size, [](int i, int j) { return (i * 7 + j) % 11 - 5; });
+	TMatrix<int> b = CreateMatrix<int>(size, [](int i, int j) { return (i + 3 * j) % 13 - 6; });
+
+	ASSERT_EQ(MultiplyByDefinition(a, b), a * b);
+}
+
+TEST(TMatrix, cant_multiply_matrices_with_not_equal_size)
+{
+	TMatrix<int> a(10);
+	TMatrix<int> b(15);
+	ASSERT_ANY_THROW(a * b);
+}
+
+TEST(TMatrix, can_multiply_matrix_by_vector)
+{
+	const int size = 3;
+	TMatrix<int> m = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TVector<int> v(size);
+	v[0] = 1; v[1] = 2; v[2] = 3;
+	TVector<int> expected(size);
+	expected[0] = 0 * 1 + 1 * 2 + 2 * 3;
+	expected[1] = 4 * 2 + 5 * 3;
+	expected[2] = 8 * 3;
+
+	ASSERT_EQ(expected, m * v);
+}
+
+TEST(TMatrix, can_multiply_vector_by_matrix)
+{
+	const int size = 3;
+	TMatrix<int> m = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TVector<int> v(size);
+	v[0] = 1; v[1] = 2; v[2] = 3;
+	TVector<int> expected(size);
+	expected[0] = 1 * 0;
+	expected[1] = 1 * 1 + 2 * 4;
+	expected[2] = 1 * 2 + 2 * 5 + 3 * 8;
+
+	ASSERT_EQ(expected, v * m);
+}
+
+TEST(TMatrix, matrix_vector_products_agree_with_matrix_product)
+{
+	// compare against sums computed through the checked operator[]
+	const int size = 37;
+	TMatrix<int> m = CreateMatrix<int>(size, [](int i, int j) { return (i * 5 + j) % 9 - 4; });
+	TVector<int> x(size);
+	for (int i = 0; i < size; ++i)
+	{
+		x[i] = i % 4 - 1;
+	}
+	TVector<int> ax = m * x, xa = x * m;
+	for (int i = 0; i < size; ++i)
+	{
+		int sumRow = 0, sumColumn = 0;
+		for (int k = i; k < size; ++k)
+		{
+			sumRow += m[i][k] * x[k];
+		}
+		for (int k = 0; k <= i; ++k)
+		{
+			sumColumn += x[k] * m[k][i];
+		}
+		EXPECT_EQ(sumRow, ax[i]);
+		EXPECT_EQ(sumColumn, xa[i]);
+	}
+}
+
+TEST(TMatrix, cant_multiply_matrix_by_vector_with_not_equal_size)
+{
+	TMatrix<int> m(10);
+	TVector<int> v(12);
+	ASSERT_ANY_THROW(m * v);
+	ASSERT_ANY_THROW(v * m);
+}
+
+TEST(TMatrix, can_solve_system)
+{
+	const int size = 3;
+	TMatrix<double> m(size);
+	m[0][0] = 2; m[0][1] = 1; m[0][2] = -1;
+	m[1][1] = 4; m[1][2] = 2;
+	m[2][2] = 5;
+	TVector<double> b(size);
+	b[0] = 1; b[1] = 10; b[2] = 10;
+
+	Solve(m, b);
+
+	EXPECT_DOUBLE_EQ(0.75, b[0]);
+	EXPECT_DOUBLE_EQ(1.5, b[1]);
+	EXPECT_DOUBLE_EQ(2.0, b[2]);
+}
+
+TEST(TMatrix, solve_inverts_matrix_vector_product)
+{
+	const int size = 150;
+	TMatrix<double> m = CreateMatrix<double>(size, [](int i, int j) { return i == j ? 2.0 + i % 3 : ((i + j) % 5 - 2) * 0.1; });
+	TVector<double> x(size);
+	for (int i = 0; i < size; ++i)
+	{
+		x[i] = i % 7 - 3;
+	}
+	TVector<double> b = m * x;
+
+	Solve(m, b);
+
+	for (int i = 0; i < size; ++i)
+	{
+		EXPECT_NEAR(x[i], b[i], 1e-9);
+	}
+}
+
+TEST(TMatrix, can_solve_system_with_many_right_hand_sides)
+{
+	// more rows than one block, so the off-diagonal updates are exercised
+	const int size = 2 * TRSM_BLOCK_SIZE + 9, count = 5;
+	TMatrix<double> m = CreateMatrix<double>(size, [](int i, int j) { return i == j ? 3.0 : ((i * j) % 7 - 3) * 0.05; });
+	TVector<TVector<double> > rhs(count), expected(count);
+	for (int r = 0; r < count; ++r)
+	{
+		expected[r] = TVector<double>(size);
+		for (int i = 0; i < size; ++i)
+		{
+			expected[r][i] = (i + r) % 5 - 2;
+		}
+		rhs[r] = m * expected[r];
+	}
+
+	Solve(m, rhs);
+
+	for (int r = 0; r < count; ++r)
+	{
+		for (int i = 0; i < size; ++i)
+		{
+			EXPECT_NEAR(expected[r][i], rhs[r][i], 1e-9);
+		}
+	}
+}
+
+TEST(TMatrix, throws_when_solve_system_with_zero_pivot)
+{
+	TMatrix<double> m = CreateMatrix<double>(5, ConstantFunction<double>, 1.0);
+	m[3][3] = 0;
+	TVector<double> b(5);
+	ASSERT_ANY_THROW(Solve(m, b));
+}
+
+TEST(TMatrix, throws_when_solve_system_with_right_hand_side_of_different_size)
+{
+	TMatrix<double> m = CreateMatrix<double>(5, ConstantFunction<double>, 1.0);
+	TVector<double> b(6);
+	TVector<TVector<double> > rhs(2);
+	rhs[0] = TVector<double>(5);
+	rhs[1] = TVector<double>(6);
+	ASSERT_ANY_THROW(Solve(m, b));
+	ASSERT_ANY_THROW(Solve(m, rhs));
+}
+
+TEST(TMatrix, can_create_zero_filled_matrix)
+{
+	const int size = 300;
+	TMatrix<double> m(size, INIT_ZERO);
+	for (int i = 0; i < size; ++i)
+	{
+		for (int j = i; j < size; ++j)
+		{
+			ASSERT_EQ(0.0, m[i][j]);
+		}
+	}
+}
+
+TEST(TMatrix, zero_filled_matrix_of_class_type_is_value_initialized)
+{
+	struct TPoint
+	{
+		int x, y;
+	};
+	TMatrix<TPoint> m(4, INIT_ZERO);
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = i; j < 4; ++j)
+		{
+			EXPECT_EQ(0, m[i][j].x);
+			EXPECT_EQ(0, m[i][j].y);
+		}
+	}
+}
+
+TEST(TMatrix, can_write_to_uninitialized_matrix)
+{
+	TMatrix<int> m(5, INIT_UNINITIALIZED);
+	m[1][3] = 7;
+	EXPECT_EQ(7, m[1][3]);
+}
+
+TEST(TMatrix, unchecked_access_matches_checked_access)
+{
+	TMatrix<int> m = CreateMatrix<int>(6, ElementsNumberFunction<int>, 6);
+	const TMatrix<int> &cm = m;
+	for (int i = 0; i < 6; ++i)
+	{
+		for (int j = i; j < 6; ++j)
+		{
+			EXPECT_EQ(&m[i][j], &m.UncheckedAt(i, j));
+			EXPECT_EQ(&m[i][j], &m[i].UncheckedAt(j));
+			EXPECT_EQ(m[i][j], cm.UncheckedAt(i, j));
+		}
+	}
+}
+
+TEST(TMatrix, row_iterators_cover_stored_part_of_row)
+{
+	TMatrix<int> m = CreateMatrix<int>(5, ElementsNumberFunction<int>, 5);
+	EXPECT_EQ(&m[2][2], m[2].data());
+	EXPECT_EQ(3, m[2].end() - m[2].begin());
+	const int expected = 12 + 13 + 14;
+	EXPECT_EQ(expected, std::accumulate(m[2].begin(), m[2].end(), 0));
+}
+
+TEST(TMatrix, can_modify_row_with_algorithms)
+{
+	TMatrix<int> m = CreateMatrix<int>(4, ConstantFunction<int>, 1);
+	std::fill(m[1].begin(), m[1].end(), 7);
+	const TMatrix<int> &cm = m;
+	EXPECT_EQ(21, std::accumulate(cm[1].begin(), cm[1].end(), 0));
+	EXPECT_EQ(1, m[0][1]);
+	EXPECT_EQ(1, m[2][2]);
+}
+
+TEST(TMatrix, can_transform_reduce_rows)
+{
+	TMatrix<double> m = CreateMatrix<double>(6, ConstantFunction<double>, 2.0);
+	TVector<double> x(6);
+	std::fill(x.begin(), x.end(), 0.5);
+	// the stored part of row 3 times x(3..5) is A * x for that row
+	double dot = std::transform_reduce(m[3].begin(), m[3].end(), x.begin() + 3, 0.0);
+	EXPECT_DOUBLE_EQ((m * x)[3], dot);
+}
+
+TEST(TMatrix, copy_of_large_matrix_is_equal_to_source)
+{
+	TMatrix<double> m1 = CreateMatrix<double>(300, ElementsNumberFunction<double>, 300);
+	TMatrix<double> m2(m1), m3(300);
+	m3 = m1;
+	EXPECT_EQ(m1, m2);
+	EXPECT_EQ(m1, m3);
+}
+
+TEST(TMatrix, copy_on_write_is_off_by_default)
+{
+	TMatrix<int> m(5);
+	EXPECT_FALSE(m.IsCopyOnWrite());
+}
+
+TEST(TMatrix, copy_on_write_copy_shares_buffer)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	const TMatrix<int> m2(m1);
+	const TMatrix<int> &cm1 = m1;
+
+	EXPECT_TRUE(m2.IsCopyOnWrite());
+	EXPECT_EQ(&cm1[0][0], &m2[0][0]);
+	EXPECT_EQ(m1, m2);
+}
+
+TEST(TMatrix, copy_on_write_copy_gets_own_memory_on_write)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	TMatrix<int> m2(m1);
+	m2[1][2] = -1;
+
+	EXPECT_NE(&m1[0][0], &m2[0][0]);
+	EXPECT_EQ(-1, m2[1][2]);
+	EXPECT_NE(-1, m1[1][2]);
+}
+
+TEST(TMatrix, copy_on_write_source_gets_own_memory_on_write)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	TMatrix<int> m2(m1);
+	m1 += m1;
+
+	EXPECT_EQ(CreateMatrix<int>(size, ElementsNumberFunction<int>, size), m2);
+	EXPECT_NE(m1, m2);
+}
+
+TEST(TMatrix, copied_matrix_has_its_own_memory_with_copy_on_write)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	TMatrix<int> m2(m1);
+	ASSERT_NE(&(m1[0][0]), &(m2[0][0]));
+}
+
+TEST(TMatrix, assign_copy_on_write_matrix_shares_buffer)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	TMatrix<int> m2(3);
+	m2 = m1;
+	const TMatrix<int> &cm1 = m1, &cm2 = m2;
+
+	EXPECT_EQ(&cm1[0][0], &cm2[0][0]);
+	m2 *= 2;
+	EXPECT_EQ(CreateMatrix<int>(size, ElementsNumberFunction<int>, size), m1);
+}
+
+TEST(TMatrix, shared_buffer_outlives_source)
+{
+	const int size = 10;
+	TMatrix<int> *pM1 = new TMatrix<int>(CreateMatrix<int>(size, ElementsNumberFunction<int>, size));
+	pM1->SetCopyOnWrite(true);
+	TMatrix<int> m2(*pM1);
+	delete pM1;
+
+	EXPECT_EQ(CreateMatrix<int>(size, ElementsNumberFunction<int>, size), m2);
+}
+
+TEST(TMatrix, can_turn_off_copy_on_write)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	TMatrix<int> m2(m1);
+	m2.SetCopyOnWrite(false);
+	const TMatrix<int> &cm1 = m1, &cm2 = m2;
+
+	EXPECT_FALSE(m2.IsCopyOnWrite());
+	EXPECT_NE(&cm1[0][0], &cm2[0][0]);
+	EXPECT_EQ(m1, m2);
+}
+
+TEST(TMatrix, copy_on_write_copy_does_not_see_writes_through_row_taken_before)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	TMatrixRow<int> r = m1[0];
+	const TMatrix<int> m2(m1);
+	r[1] = -1;
+
+	EXPECT_EQ(-1, m1[0][1]);
+	EXPECT_EQ(CreateMatrix<int>(size, ElementsNumberFunction<int>, size), m2);
+}
+
+TEST(TMatrix, copy_on_write_copy_does_not_see_writes_through_reference_taken_before)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	int &e = m1[1][1];
+	int &u = m1.UncheckedAt(2, 3);
+	TMatrix<int> m2(3);
+	m2 = m1;
+	e = -1;
+	u = -2;
+
+	EXPECT_EQ(CreateMatrix<int>(size, ElementsNumberFunction<int>, size), m2);
+}
+
+TEST(TMatrix, copy_on_write_const_access_keeps_buffer_shareable)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	const TMatrix<int> &cm1 = m1;
+	const int sum = cm1[1][1] + cm1.UncheckedAt(2, 3) + cm1.View().Diagonal()[0];
+	const TMatrix<int> m2(m1);
+
+	EXPECT_NE(0, sum);
+	EXPECT_EQ(&cm1[0][0], &m2[0][0]);
+}
+
+TEST(TMatrix, copy_on_write_buffer_is_shared_again_after_reallocation)
+{
+	const int size = 10;
+	TMatrix<int> m1 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	m1.SetCopyOnWrite(true);
+	m1[0][0] = 1;
+	const TMatrix<int> m3(size + 1, INIT_ZERO);
+	m1 = m3;
+	const TMatrix<int> m2(m1);
+	const TMatrix<int> &cm1 = m1;
+
+	EXPECT_EQ(&cm1[0][0], &m2[0][0]);
+}
+
+TEST(TMatrix, row_assignment_copies_elements)
+{
+	const int size = 5;
+	const TMatrix<int> m2 = CreateMatrix<int>(size, ElementsNumberFunction<int>, size);
+	TMatrix<int> m1(size, INIT_ZERO), m3(size, INIT_ZERO);
+	m1[0] = m3[0];
+	m3[1] = m2[1];
+	m1[2] = m1[2];
+	TMatrixRow<int> r = m1[0];
+	r = m2[0];
+
+	EXPECT_EQ(TVector<int>(m2[1]), TVector<int>(m3[1]));
+	EXPECT_EQ(TVector<int>(m2[0]), TVector<int>(m1[0]));
+	EXPECT_EQ(0, m3[0][0]);
+}
+
+TEST(TMatrix, throws_when_assign_row_of_different_shape)
+{
+	TMatrix<int> m(5, INIT_ZERO);
+
+	ASSERT_ANY_THROW(m[0] = m[1]);
+}
+
+TEST(TMatrix, row_converts_only_to_const_row)
+{
+	typedef TMatrixRow<int> TRow;
+	typedef TMatrixRow<const int> TConstRow;
+
+	EXPECT_TRUE((std::is_convertible<TRow, TConstRow>::value));
+	EXPECT_FALSE((std::is_convertible<TConstRow, TRow>::value));
+	EXPECT_FALSE((std::is_constructible<TRow, TConstRow>::value));
+	EXPECT_TRUE((std::is_assignable<const TRow&, TConstRow>::value));
+	EXPECT_FALSE((std::is_assignable<const TRow&, TMatrixRow<const double> >::value));
+}
+
+TEST(TMatrix, many_right_hand_sides_match_single_solves)
+{
+	const int size = 3 * TRSM_BLOCK_SIZE + 5, count = 11;
+	TMatrix<double> m = CreateMatrix<double>(size, [](int i, int j) { return i == j ? 2.0 + i % 3 : ((i + 2 * j) % 9 - 4) * 0.03; });
+	TVector<TVector<double> > rhs(count);
+	for (int r = 0; r < count; ++r)
+	{
+		rhs[r] = TVector<double>(size);
+		for (int i = 0; i < size; ++i)
+			rhs[r][i] = (i * (r + 1)) % 13 - 6;
+	}
+	TVector<TVector<double> > single(rhs);
+
+	Solve(m, rhs);
+
+	for (int r = 0; r < count; ++r)
+	{
+		Solve(m, single[r]);
+		for (int i = 0; i < size; ++i)
+			EXPECT_NEAR(single[r][i], rhs[r][i], 1e-9);
+	}
+}
@@ -1,6 +1,10 @@
 #include "utmatrix.h"
 
 #include <gtest.h>
+#include <climits>
+#include <cstdint>
+#include <numeric>
+#include <string>
 
 namespace
 {
@@ -251,3 +255,318 @@ TEST(TVector, cant_multiply_vectors_with_not_equal_size)
 	ASSERT_ANY_THROW(v * v1);
 }
 
+TEST(TVector, move_constructor_takes_source_memory)
+{
+	TVector<int> v = CreateVector<int>(10, IdentityFunction<int>);
+	const int *pData = &(v[0]);
+	TVector<int> v1(std::move(v));
+	EXPECT_EQ(pData, &(v1[0]));
+	EXPECT_EQ(0, v.GetSize());
+}
+
+TEST(TVector, can_move_assign_vector)
+{
+	TVector<int> v = CreateVector<int>(5, IdentityFunction<int>);
+	TVector<int> expected(v);
+	TVector<int> v1(10);
+	v1 = std::move(v);
+	ASSERT_EQ(expected, v1);
+}
+
+TEST(TVector, can_swap_vectors)
+{
+	TVector<int> v = CreateVector<int>(5, IdentityFunction<int>);
+	TVector<int> v1 = CreateVector<int>(7, ConstantFunction<int>, 3);
+	TVector<int> expected(v), expected1(v1);
+	swap(v, v1);
+	EXPECT_EQ(expected1, v);
+	EXPECT_EQ(expected, v1);
+}
+
+TEST(TVector, operation_on_temporary_reuses_its_memory)
+{
+	TVector<int> v = CreateVector<int>(10, IdentityFunction<int>);
+	TVector<int> v1 = CreateVector<int>(10, ConstantFunction<int>, 5);
+	TVector<int> tmp(v);
+	const int *pData = &(tmp[0]);
+
+	TVector<int> actual = std::move(tmp) + v1 - v;
+
+	EXPECT_EQ(pData, &(actual[0]));
+	EXPECT_EQ(v1, actual);
+}
+
+TEST(TVector, can_evaluate_chained_expression)
+{
+	TVector<int> a = CreateVector<int>(10, IdentityFunction<int>);
+	TVector<int> b = CreateVector<int>(10, ConstantFunction<int>, 3);
+	TVector<int> c = CreateVector<int>(10, IdentityFunction<int>);
+
+	TVector<int> expected = CreateVector<int>(10, [](int i) { return 3 - i; });
+
+	TVector<int> actual = a + b - c * 2;
+	ASSERT_EQ(expected, actual);
+}
+
+TEST(TVector, can_assign_expression_with_vector_as_operand)
+{
+	TVector<int> a = CreateVector<int>(10, IdentityFunction<int>);
+	TVector<int> b = CreateVector<int>(10, ConstantFunction<int>, 1);
+
+	TVector<int> expected = CreateVector<int>(10, [](int i) { return i + 1; });
+
+	a = a + b;
+	ASSERT_EQ(expected, a);
+}
+
+TEST(TVector, throws_when_expression_operands_have_different_size)
+{
+	TVector<int> a(10), b(10), c(12);
+	ASSERT_ANY_THROW(a + b - c);
+}
+
+TEST(TVector, can_find_dot_product_of_expressions)
+{
+	TVector<int> a = CreateVector<int>(5, IdentityFunction<int>);
+	TVector<int> b = CreateVector<int>(5, ConstantFunction<int>, 1);
+
+	ASSERT_EQ((1 + 2 + 3 + 4 + 5) * 2, (a + b) * (b * 2));
+}
+
+TEST(TVector, can_add_vector_in_place_without_reallocation)
+{
+	TVector<int> v = CreateVector<int>(10, IdentityFunction<int>);
+	TVector<int> v1 = CreateVector<int>(10, ConstantFunction<int>, 5);
+	const int *pData = &(v[0]);
+
+	TVector<int> expected = CreateVector<int>(10, [](int i) { return i + 5; });
+
+	v += v1;
+
+	EXPECT_EQ(pData, &(v[0]));
+	EXPECT_EQ(expected, v);
+}
+
+TEST(TVector, can_subtract_expression_in_place)
+{
+	TVector<int> v = CreateVector<int>(10, IdentityFunction<int>);
+	TVector<int> v1 = CreateVector<int>(10, IdentityFunction<int>);
+
+	TVector<int> expected = CreateVector<int>(10, [](int i) { return -i; });
+
+	v -= v1 * 2;
+	ASSERT_EQ(expected, v);
+}
+
+TEST(TVector, cant_add_vector_of_different_size_in_place)
+{
+	TVector<int> v(10);
+	TVector<int> v1(12);
+	ASSERT_ANY_THROW(v += v1);
+}
+
+TEST(TVector, can_multiply_and_divide_by_scalar_in_place)
+{
+	TVector<int> v = CreateVector<int>(10, IdentityFunction<int>);
+
+	TVector<int> expected = CreateVector<int>(10, [](int i) { return 2 * i; });
+
+	v *= 6;
+	v /= 3;
+	ASSERT_EQ(expected, v);
+}
+
+TEST(TVector, can_do_axpy)
+{
+	TVector<int> y = CreateVector<int>(10, ConstantFunction<int>, 1);
+	TVector<int> x = CreateVector<int>(10, IdentityFunction<int>);
+
+	TVector<int> expected = CreateVector<int>(10, [](int i) { return 1 + 3 * i; });
+
+	y.Axpy(3, x);
+	ASSERT_EQ(expected, y);
+}
+
+TEST(TVector, unchecked_access_uses_start_index)
+{
+	TVector<int> v(4, 2);
+	v.UncheckedAt(3) = 5;
+	EXPECT_EQ(5, v[3]);
+	const TVector<int> &cv = v;
+	EXPECT_EQ(&v[2], &cv.UncheckedAt(2));
+}
+
+TEST(TVector, const_access_checks_index)
+{
+	const TVector<int> v(4, 2);
+	ASSERT_ANY_THROW(v[1]);
+	ASSERT_ANY_THROW(v[6]);
+	ASSERT_NO_THROW(v[5]);
+}
+
+TEST(TVector, iterators_cover_stored_elements)
+{
+	TVector<int> v(5, 3);
+	std::iota(v.begin(), v.end(), 1);
+	EXPECT_EQ(v.data(), &v[3]);
+	EXPECT_EQ(5, v.end() - v.begin());
+	EXPECT_EQ(1, v[3]);
+	EXPECT_EQ(5, v[7]);
+	const TVector<int> &cv = v;
+	EXPECT_EQ(15, std::accumulate(cv.begin(), cv.end(), 0));
+}
+
+TEST(TVector, can_use_range_for)
+{
+	TVector<int> v(4);
+	for (int &x : v)
+	{
+		x = 2;
+	}
+	int sum = 0;
+	for (int x : v)
+	{
+		sum += x;
+	}
+	EXPECT_EQ(8, sum);
+}
+
+TEST(TVector, assign_of_same_size_reuses_buffer)
+{
+	TVector<double> v1(8, 1), v2(8, 3);
+	std::fill(v1.begin(), v1.end(), 1.5);
+	const double *pBuffer = v2.data();
+	v2 = v1;
+	EXPECT_EQ(pBuffer, v2.data());
+	EXPECT_EQ(v1, v2);
+}
+
+TEST(TVector, can_copy_vector_of_non_trivial_type)
+{
+	TVector<std::string> v1(3);
+	v1[0] = "a";
+	v1[1] = "bb";
+	v1[2] = "ccc";
+	TVector<std::string> v2(v1), v3(5);
+	v3 = v1;
+	EXPECT_EQ(v1, v2);
+	EXPECT_EQ(v1, v3);
+}
+
+#if PTRDIFF_MAX > INT_MAX
+TEST(TVector, can_use_start_index_beyond_int_range)
+{
+	const TIndex first = (TIndex)INT_MAX + 10;
+	TVector<int> v(3, first);
+	v[first + 2] = 7;
+
+	EXPECT_EQ(first, v.GetStartIndex());
+	EXPECT_EQ(7, v[first + 2]);
+	ASSERT_ANY_THROW(v[first - 1] = 1);
+	ASSERT_ANY_THROW(v[first + 3] = 1);
+}
+#endif
+
+namespace
+{
+	template <class VectorType>
+	bool IsInsideObject(const VectorType &v)
+	{
+		const char *p = reinterpret_cast<const char*>(v.data());
+		const char *pObject = reinterpret_cast<const char*>(&v);
+		return p >= pObject && p < pObject + sizeof(v);
+	}
+
+	TVector<double> CreateSequence(int theSize, double theFirst)
+	{
+		TVector<double> v(theSize);
+		for (int i = 0; i < theSize; i++)
+			v[i] = theFirst + i;
+		return v;
+	}
+}
+
+TEST(TVector, short_vector_stores_elements_inside_object)
+{
+	if (VECTOR_INLINE_SIZE == 0)
+		return;
+	TVector<double> v1((int)VECTOR_INLINE_SIZE), v2((int)VECTOR_INLINE_SIZE + 1);
+
+	EXPECT_TRUE(IsInsideObject(v1));
+	EXPECT_FALSE(IsInsideObject(v2));
+}
+
+TEST(TVector, can_move_short_vector)
+{
+	TVector<double> v1 = CreateSequence(2, 1.0);
+	TVector<double> v2(std::move(v1));
+
+	EXPECT_EQ(CreateSequence(2, 1.0), v2);
+	EXPECT_EQ(0, v1.GetSize());
+	v1 = std::move(v2);
+	EXPECT_EQ(CreateSequence(2, 1.0), v1);
+}
+
+TEST(TVector, can_swap_short_and_long_vectors)
+{
+	TVector<double> v1 = CreateSequence(3, 1.0), v2 = CreateSequence(50, 10.0);
+	swap(v1, v2);
+
+	EXPECT_EQ(CreateSequence(50, 10.0), v1);
+	EXPECT_EQ(CreateSequence(3, 1.0), v2);
+	swap(v1, v2);
+	EXPECT_EQ(CreateSequence(3, 1.0), v1);
+	EXPECT_EQ(CreateSequence(50, 10.0), v2);
+	v1.swap(v1);
+	EXPECT_EQ(CreateSequence(3, 1.0), v1);
+}
+
+TEST(TVector, can_assign_across_inline_size)
+{
+	TVector<double> v(2);
+	const TVector<double> aLong = CreateSequence(40, 0.5), aShort = CreateSequence(1, 7.0);
+	v = aLong;
+	EXPECT_EQ(aLong, v);
+	v = aShort;
+	EXPECT_EQ(aShort, v);
+	v = aLong + aLong;
+	EXPECT_EQ(TVector<double>(aLong * 2.0), v);
+	v = aShort * 3.0;
+	EXPECT_EQ(21.0, v[0]);
+}
+
+TEST(TVector, move_and_swap_keep_data_only_of_long_vectors)
+{
+	TVector<double> aShort = CreateSequence((int)VECTOR_INLINE_SIZE, 1.0), aLong = CreateSequence(50, 1.0);
+	const double *pShort = aShort.data(), *pLong = aLong.data();
+	TVector<double> aMovedShort(std::move(aShort)), aMovedLong(std::move(aLong));
+
+	EXPECT_EQ(pLong, aMovedLong.data());
+	EXPECT_EQ(VECTOR_INLINE_SIZE == 0, pShort == aMovedShort.data());
+	TVector<double> aOtherShort = CreateSequence(1, 5.0), aOtherLong = CreateSequence(60, 5.0);
+	const double *pOtherShort = aOtherShort.data(), *pOtherLong = aOtherLong.data();
+	aMovedLong.swap(aOtherLong);
+	aMovedShort.swap(aOtherShort);
+
+	EXPECT_EQ(pOtherLong, aMovedLong.data());
+	EXPECT_EQ(pLong, aOtherLong.data());
+	EXPECT_EQ(VECTOR_INLINE_SIZE == 0, pOtherShort == aMovedShort.data());
+}
+
+TEST(TVector, empty_inline_buffer_does_not_enlarge_vector)
+{
+	struct TFields
+	{
+		double *pVector;
+		TIndex Size, StartIndex;
+		TArenaAllocator<double> Alloc;
+	};
+	struct TNestedFields
+	{
+		TVector<double> *pVector;
+		TIndex Size, StartIndex;
+		std::allocator<TVector<double> > Alloc;
+	};
+	static_assert(sizeof(TVector<double, TArenaAllocator<double> >) == sizeof(TFields), "inline buffer adds padding");
+	static_assert(sizeof(TVector<TVector<double> >) == sizeof(TNestedFields), "inline buffer adds padding");
+}
@@ -0,0 +1,249 @@
+#include "utmatrix.h"
+#include "test_helpers.h"
+
+#include <gtest.h>
+#include <cmath>
+
+namespace
+{
+	// Unit diagonal keeps the inverse well conditioned.
+	TMatrix<double> CreateUnitMatrix(int theSize)
+	{
+		TMatrix<double> m(theSize);
+		for (int i = 0; i < theSize; i++)
+		{
+			m[i][i] = 1;
+			for (int j = i + 1; j < theSize; j++)
+				m[i][j] = ((i + 2 * j) % 5 - 2) / 16.0;
+		}
+		return m;
+	}
+}
+
+TEST(TView, triangle_view_refers_to_matrix_elements)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TTriangleView<double> v = m.View();
+
+	EXPECT_EQ(10, v.GetSize());
+	EXPECT_EQ(&m[2][5], &v(2, 5));
+}
+
+TEST(TView, trailing_view_is_shifted_by_order)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TTriangleView<double> v = m.View().Trailing(4);
+
+	EXPECT_EQ(6, v.GetSize());
+	EXPECT_EQ(&m[5][9], &v(1, 5));
+}
+
+TEST(TView, leading_view_rows_are_prefixes_of_matrix_rows)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TTriangleView<double> v = m.View().Leading(4);
+
+	EXPECT_EQ(4, v.GetSize());
+	EXPECT_EQ(&m[3][3], v.Row(3));
+}
+
+TEST(TView, block_view_refers_to_matrix_elements)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TBlockView<double> b = m.View().Block(1, 4, 5, 9);
+
+	EXPECT_EQ(3, b.GetRows());
+	EXPECT_EQ(4, b.GetCols());
+	EXPECT_EQ(&m[1][5], b.Row(0));
+	EXPECT_EQ(&m[3][8], &b(2, 3));
+}
+
+TEST(TView, column_view_has_stored_part_of_column)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TStridedView<double> c = m.View().Column(6);
+
+	ASSERT_EQ(7, c.GetSize());
+	for (int i = 0; i < 7; i++)
+		EXPECT_EQ(&m[i][6], &c[i]);
+}
+
+TEST(TView, diagonal_view_has_elements_of_diagonal)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TStridedView<double> d = m.View().Trailing(2).Diagonal(3);
+
+	ASSERT_EQ(5, d.GetSize());
+	for (int i = 0; i < 5; i++)
+		EXPECT_EQ(&m[i + 2][i + 5], &d[i]);
+}
+
+TEST(TView, block_column_view_has_elements_of_column)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TStridedView<double> c = m.View().Block(2, 5, 6, 10).Column(1);
+
+	ASSERT_EQ(3, c.GetSize());
+	for (int i = 0; i < 3; i++)
+		EXPECT_EQ(&m[i + 2][7], &c[i]);
+}
+
+TEST(TView, can_add_triangle_views_in_place)
+{
+	TMatrix<double> m1 = CreateFilledMatrix(10), m2 = CreateFilledMatrix(10, 2);
+	TMatrix<double> expected(m1);
+	m1.View().Trailing(3) += m2.View().Trailing(3);
+	for (int i = 3; i < 10; i++)
+		for (int j = i; j < 10; j++)
+			expected[i][j] += m2[i][j];
+
+	EXPECT_EQ(expected, m1);
+}
+
+TEST(TView, can_scale_block_view)
+{
+	TMatrix<double> m = CreateFilledMatrix(10);
+	TMatrix<double> expected(m);
+	m.View().Block(0, 3, 4, 8) *= 2;
+	for (int i = 0; i < 3; i++)
+		for (int j = 4; j < 8; j++)
+			expected[i][j] *= 2;
+
+	EXPECT_EQ(expected, m);
+}
+
+TEST(TView, can_copy_diagonal)
+{
+	TMatrix<double> m1 = CreateFilledMatrix(10), m2 = CreateFilledMatrix(10, 2);
+	m1.View().Diagonal().CopyFrom(m2.View().Diagonal());
+
+	for (int i = 0; i < 10; i++)
+		EXPECT_EQ(m2[i][i], m1[i][i]);
+	EXPECT_NE(m2[0][1], m1[0][1]);
+}
+
+TEST(TView, views_of_equal_parts_are_equal)
+{
+	TMatrix<double> m1 = CreateFilledMatrix(10), m2(4);
+	m2.View().CopyFrom(m1.View().Trailing(6));
+	const TMatrix<double> &cm1 = m1;
+
+	EXPECT_TRUE(m2.View() == cm1.View().Trailing(6));
+}
+
+TEST(TView, throws_when_block_is_below_diagonal)
+{
+	TMatrix<double> m(10);
+
+	ASSERT_ANY_THROW(m.View().Block(3, 6, 2, 8));
+}
+
+TEST(TView, throws_when_view_is_out_of_matrix)
+{
+	TMatrix<double> m(10);
+
+	ASSERT_ANY_THROW(m.View().Leading(11));
+	ASSERT_ANY_THROW(m.View().Trailing(10));
+	ASSERT_ANY_THROW(m.View().Column(10));
+	ASSERT_ANY_THROW(m.View().Block(0, 2, 5, 11));
+}
+
+TEST(TView, view_of_shared_matrix_gets_own_memory)
+{
+	TMatrix<double> m1 = CreateFilledMatrix(10);
+	m1.SetCopyOnWrite(true);
+	TMatrix<double> m2(m1);
+	m2.View() *= 0;
+
+	EXPECT_EQ(CreateFilledMatrix(10), m1);
+}
+
+TEST(TView, recursive_multiplication_matches_matrix_product)
+{
+	TMatrix<double> a = CreateFilledMatrix(200), b = CreateFilledMatrix(200, 3);
+	TMatrix<double> c(200, INIT_ZERO);
+	MultiplyAdd(c.View(), a.View(), b.View());
+
+	EXPECT_EQ(a * b, c);
+}
+
+TEST(TView, can_multiply_block_by_triangle)
+{
+	TMatrix<double> a = CreateFilledMatrix(20), c(20, INIT_ZERO);
+	TMatrix<double> expected(20, INIT_ZERO);
+	MultiplyAdd(c.View().Block(0, 5, 5, 20), a.View().Block(0, 5, 5, 20), a.View().Trailing(5));
+	for (int i = 0; i < 5; i++)
+		for (int j = 5; j < 20; j++)
+			for (int k = 5; k <= j; k++)
+				expected[i][j] += a[i][k] * a[k][j];
+
+	EXPECT_EQ(expected, c);
+}
+
+TEST(TView, recursive_solve_matches_solve)
+{
+	TMatrix<double> a = CreateUnitMatrix(150);
+	TVector<double> b(150), x(150);
+	for (int i = 0; i < 150; i++)
+		b[i] = x[i] = i % 7 - 3;
+	Solve(a, b);
+	const TMatrix<double> &ca = a;
+	SolveInPlace(ca.View(), x.data());
+
+	for (int i = 0; i < 150; i++)
+		EXPECT_NEAR(b[i], x[i], 1e-9);
+}
+
+TEST(TView, throws_when_solve_with_zero_pivot)
+{
+	TMatrix<double> a = CreateUnitMatrix(100);
+	a[70][70] = 0;
+	TVector<double> x(100);
+
+	ASSERT_ANY_THROW(SolveInPlace(a.View(), x.data()));
+}
+
+TEST(TView, invert_with_zero_pivot_throws_and_keeps_matrix)
+{
+	TMatrix<double> a = CreateUnitMatrix(150);
+	a[120][120] = 0;
+	const TMatrix<double> expected(a);
+
+	ASSERT_ANY_THROW(InvertInPlace(a.View()));
+	EXPECT_EQ(expected, a);
+}
+
+TEST(TView, inverted_matrix_gives_identity)
+{
+	TMatrix<double> a = CreateUnitMatrix(150), inverse(a);
+	InvertInPlace(inverse.View());
+	TMatrix<double> product = a * inverse;
+	double error = 0;
+	for (int i = 0; i < 150; i++)
+		for (int j = i; j < 150; j++)
+			error = std::max(error, std::fabs(product[i][j] - (i == j ? 1 : 0)));
+
+	EXPECT_GT(1e-9, error);
+}
+
+TEST(TView, packed_offsets_of_large_order_do_not_overflow)
+{
+	const TIndex n = 200000;
+
+	EXPECT_EQ((TIndex)20000100000LL, PackedCount(n));
+	EXPECT_EQ((TIndex)15000050000LL, PackedRowOffset(100000, n));
+	EXPECT_EQ(PackedCount(n) - 1, PackedOffset(n - 1, n - 1, n));
+	EXPECT_EQ(PackedRowOffset(n - 1, n) - 1, PackedOffset(n - 2, n - 1, n));
+}
+
+TEST(TView, copy_of_shared_matrix_does_not_see_writes_through_view_taken_before)
+{
+	TMatrix<double> m1 = CreateFilledMatrix(10);
+	m1.SetCopyOnWrite(true);
+	TTriangleView<double> v = m1.View();
+	const TMatrix<double> m2(m1);
+	v *= 0;
+
+	EXPECT_EQ(CreateFilledMatrix(10), m2);
+	EXPECT_EQ(TMatrix<double>(10, INIT_ZERO), m1);
+}